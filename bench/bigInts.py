@@ -0,0 +1,28 @@
+# big integer arithmetic: factorials, Fibonacci numbers and powers of three, with their digit sums
+def digitSum(n):
+    s = 0
+    while n > 0:
+        s += n % 10
+        n = n // 10
+    return s
+f = 1
+i = 1
+while i <= 400:
+    f = f * i
+    i += 1
+print(digitSum(f))
+a = 0
+b = 1
+i = 0
+while i < 3000:
+    c = a + b
+    a = b
+    b = c
+    i += 1
+print(digitSum(a))
+p = 1
+i = 0
+while i < 1500:
+    p = p * 3 - i
+    i += 1
+print(digitSum(p), p % 1000000007)
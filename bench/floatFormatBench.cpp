@@ -0,0 +1,41 @@
+// Formats millions of doubles with formatFixed6 and with snprintf("%0.6f"), reports the time per value of each
+// and fails if any text differs.
+// usage: floatFormatBench [count]
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "floatFormat.hpp"
+using namespace std;
+
+int main(int argc, const char* argv[]) {
+    const size_t count = argc > 1 ? strtoull(argv[1], nullptr, 10) : 4000000;
+    vector<double> values;
+    values.reserve(count);
+    mt19937_64 rng(2020);
+    for(size_t i = 0; i < count; i++) {
+        const double x = ldexp((double) (rng() >> 11), -53) * pow(10.0, (int) (rng() % 24) - 8); // 1e-8 .. 1e15
+        if(i % 4 == 3) values.push_back(floor(x * 1e6) / 1e6 + 5e-7); // next to a rounding boundary
+        else values.push_back(rng() & 1 ? -x : x);
+    }
+    char ours[fixedBufferSize], theirs[fixedBufferSize];
+    size_t mismatches = 0, sink = 0;
+    for(auto x: values) {
+        const int n = formatFixed6(x, ours), m = snprintf(theirs, sizeof theirs, "%0.6f", x);
+        if(n != m || memcmp(ours, theirs, n)) {
+            if(++mismatches <= 5) printf("mismatch: %.17g gives %.*s, snprintf %s\n", x, n, ours, theirs);
+        }
+    }
+    auto start = chrono::steady_clock::now();
+    for(auto x: values) sink += formatFixed6(x, ours);
+    const double fixed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    start = chrono::steady_clock::now();
+    for(auto x: values) sink += snprintf(theirs, sizeof theirs, "%0.6f", x);
+    const double libc = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("%zu values, %zu bytes: formatFixed6 %.1f ns/value, snprintf %.1f ns/value, %zu mismatches\n", count, sink / 2,
+           fixed * 1e9 / count, libc * 1e9 / count, mismatches);
+    return mismatches ? 1 : 0;
+}
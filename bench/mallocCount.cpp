@@ -0,0 +1,33 @@
+// Counts the malloc, calloc, realloc and free calls of a process and reports them on stderr at exit. Unlike
+// --alloc-stats, it sees every allocation, libc's and the runtime's included, and works with any build of the
+// interpreter, so two builds can be compared on the same program.
+// usage: LD_PRELOAD=path/to/libmallocCount.so code < program.py
+#include <cstddef>
+#include <cstdio>
+
+extern "C" {
+void* __libc_malloc(size_t n);
+void* __libc_calloc(size_t count, size_t n);
+void* __libc_realloc(void *p, size_t n);
+void __libc_free(void *p);
+
+static size_t mallocs, callocs, reallocs, frees;
+
+void* malloc(size_t n) {
+    return mallocs++, __libc_malloc(n);
+}
+void* calloc(size_t count, size_t n) {
+    return callocs++, __libc_calloc(count, n);
+}
+void* realloc(void *p, size_t n) {
+    return reallocs++, __libc_realloc(p, n);
+}
+void free(void *p) {
+    if(p) frees++;
+    __libc_free(p);
+}
+}
+
+__attribute__((destructor)) static void report() {
+    fprintf(stderr, "malloc: %zu calls, calloc: %zu, realloc: %zu, free: %zu\n", mallocs, callocs, reallocs, frees);
+}
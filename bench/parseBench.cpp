@@ -0,0 +1,114 @@
+// Lexes and parses a program the way the interpreter does, mean of three runs, and reports the time and operator new
+// calls of each phase: with tokens and nodes in a ParseArena, with the tokens on the heap, as --stream keeps them, and
+// through Python3Parser, whose nodes all come from the heap.
+// usage: parseBench [program.py]  (without one, a 4.7 MB program of 20000 short functions)
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include "antlr4-runtime.h"
+#include "Python3Parser.h"
+#include "heapCounter.hpp"
+#include "parseArena.hpp"
+#include "scriptLexer.hpp"
+#include "scriptParser.hpp"
+#include "sourceStream.hpp"
+using namespace std;
+
+static string generate(int functions) { // the shape bench/programCache.sh writes
+    string s;
+    char line[256];
+    for(int i = 0; i < functions; i++) {
+        snprintf(line, sizeof line, "def fn%d(a, b = %d):\n    x = a * %d + b // 3 - (a %% 7)\n", i, i % 5, i), s += line;
+        snprintf(line, sizeof line, "    while x > 0 and not x == %d:\n        x -= 1 + b\n        if x < 5:\n", i), s += line;
+        snprintf(line, sizeof line, "            return str(x) + \"s%d\"\n        elif x >= 100 or b != 2:\n"
+                                    "            x = x // 2\n    return x\n", i), s += line;
+    }
+    return s;
+}
+
+struct Phase {
+    double seconds = 0;
+    size_t allocations = 0;
+};
+
+struct Run {
+    Phase lex, parse, teardown;
+};
+
+static chrono::steady_clock::time_point start;
+static size_t allocationsAtStart;
+
+static void begin() {
+    allocationsAtStart = heapCounter.allocations, start = chrono::steady_clock::now();
+}
+
+static void end(Phase &phase) {
+    phase.seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    phase.allocations += heapCounter.allocations - allocationsAtStart;
+}
+
+// useArena: the lexer's tokens go to the arena too; antlr: parse with Python3Parser (SLL) instead of ScriptParser
+static bool once(const string &source, bool useArena, bool antlr, Run &run) {
+    auto arena = unique_ptr<ParseArena>(new ParseArena);
+    auto input = unique_ptr<Utf8CharStream>(new Utf8CharStream(source.data(), source.size()));
+    auto lexer = unique_ptr<ScriptLexer>(new ScriptLexer(*input));
+    if(useArena) lexer->allocateFrom(*arena);
+    begin();
+    auto tokens = unique_ptr<antlr4::CommonTokenStream>(new antlr4::CommonTokenStream(lexer.get()));
+    tokens->fill();
+    end(run.lex);
+    unique_ptr<Python3Parser> parser;
+    begin();
+    antlr4::tree::ParseTree *tree;
+    if(antlr) {
+        parser.reset(new Python3Parser(tokens.get()));
+        parser->getInterpreter<antlr4::atn::ParserATNSimulator>()->setPredictionMode(antlr4::atn::PredictionMode::SLL);
+        parser->setErrorHandler(make_shared<antlr4::BailErrorStrategy>());
+        try {
+            tree = parser->file_input();
+        } catch(antlr4::ParseCancellationException&) {
+            tree = nullptr;
+        }
+    } else {
+        ScriptParser scriptParser(*tokens, *arena);
+        if(!(tree = scriptParser.file_input())) fprintf(stderr, "ScriptParser: %s\n", scriptParser.error.c_str());
+    }
+    end(run.parse);
+    begin();
+    parser.reset(), tokens.reset(), arena.reset();
+    end(run.teardown);
+    return tree;
+}
+
+int main(int argc, const char* argv[]) {
+    string source;
+    if(argc > 1) {
+        SourceBuffer buffer;
+        if(!buffer.open(argv[1])) {
+            fprintf(stderr, "%s: cannot read %s: %s\n", argv[0], argv[1], strerror(errno));
+            return 1;
+        }
+        source.assign(buffer.data(), buffer.size());
+    } else source = generate(20000);
+    printf("%zu bytes\n", source.size());
+    const struct {
+        const char *name;
+        bool useArena, antlr;
+    } setups[] = {{"arena", 1, 0}, {"heap tokens", 0, 0}, {"Python3Parser", 0, 1}};
+    const int runs = 3;
+    Run warmUp; // the first run also pays for growing the heap, which would go to whichever setup came first
+    if(!once(source, 1, 0, warmUp)) return 1;
+    for(auto &setup: setups) {
+        Run run;
+        for(int i = 0; i < runs; i++) {
+            if(!once(source, setup.useArena, setup.antlr, run)) return 1;
+        }
+        printf("%-14s", setup.name);
+        for(auto phase: {make_pair("lex", run.lex), make_pair("parse", run.parse), make_pair("teardown", run.teardown)})
+            printf("  %s %6.0f ms / %8zu allocs", phase.first, phase.second.seconds * 1e3 / runs, phase.second.allocations / runs);
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,7 @@
+# prints two million floats; time it against a build that formats with sprintf
+i = 0
+x = 0.1
+while i < 2000000:
+    print(x, i * 0.001, -x / 7)
+    x = x * 1.0001 + 0.37
+    i += 3
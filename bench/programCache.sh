@@ -0,0 +1,29 @@
+#!/bin/bash
+# usage: programCache.sh code [functions]
+# Times a generated program of many short functions, best of three runs: parsed and optimized every time, and
+# loaded from a --program-cache directory the first run filled.
+code=$1 functions=${2:-3000}
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+awk -v n="$functions" 'BEGIN {
+    for(i = 0; i < n; i++) {
+        printf "def fn%d(a, b = %d):\n    x = a * %d + b // 3 - (a %% 7)\n", i, i % 5, i
+        printf "    while x > 0 and not x == %d:\n        x -= 1 + b\n        if x < 5:\n", i
+        printf "            return str(x) + \"s%d\"\n        elif x >= 100 or b != 2:\n            x = x // 2\n    return x\n", i
+    }
+    for(i = 0; i < n; i += 97) print "print(fn" i "(" i ", 2))"
+}' > "$dir/program.py"
+TIMEFORMAT=%R
+best() {
+    local best= t
+    for i in 1 2 3; do
+        t=$( { time "$code" "$@" < "$dir/program.py" > /dev/null 2>&1; } 2>&1 )
+        [ -z "$best" ] || [ "$(echo "$t < $best" | awk '{print ($1 < $3)}')" = 1 ] && best=$t
+    done
+    echo "$best"
+}
+echo "$functions functions, $(wc -l < "$dir/program.py") lines"
+echo "parsed and optimized  $(best) s"
+mkdir "$dir/cache"
+"$code" --program-cache "$dir/cache" < "$dir/program.py" > /dev/null
+echo "from the program cache  $(best --program-cache "$dir/cache") s"
@@ -0,0 +1,20 @@
+#!/bin/bash
+# usage: run.sh code [other-code] [flags...]
+# Times every bench/*.py, best of three runs, under code and, when given, under another build to compare with.
+dir=$(dirname "$0")
+builds=("$1")
+shift
+[ $# -gt 0 ] && [ "${1#-}" = "$1" ] && builds+=("$1") && shift
+TIMEFORMAT=%R
+for program in "$dir"/*.py; do
+    line=$(basename "$program" .py)
+    for code in "${builds[@]}"; do
+        best=
+        for i in 1 2 3; do
+            t=$( { time "$code" "$@" < "$program" > /dev/null 2>&1; } 2>&1 )
+            [ -z "$best" ] || [ "$(echo "$t < $best" | awk '{print ($1 < $3)}')" = 1 ] && best=$t
+        done
+        line="$line  $best s"
+    done
+    echo "$line"
+done
@@ -9,36 +9,54 @@
 using namespace std;
 
 #include "dataTypes.hpp"
+#include "frameArena.hpp"
+#include "syntheticNodes.hpp"
+#include "treeUtils.hpp"
+#include "jit.hpp"
+#include "outputWriter.hpp"
 
 VariableStack vs;
 
 FlowStack flowStk, functionStk;
 
-map<string, Python3Parser::FuncdefContext*> functions;
-map<string, vector<pair<string, DataType> > > defaultArgs;
+Jit jit;
+
+// by symbol id
+map<int, Python3Parser::FuncdefContext*> functions;
+map<int, vector<pair<int, DataType> > > defaultArgs;
 
 class EvalVisitor: public Python3BaseVisitor {
+    // ctx's children of type T, as the generated list accessors give them, but built in frameArena.
+    template<class T> static ArenaVector<T*> childrenOf(antlr4::ParserRuleContext *ctx) {
+        ArenaVector<T*> ret;
+        ret.reserve(ctx->children.size());
+        for(auto i: ctx->children) if(auto t = dynamic_cast<T*>(i)) ret.push_back(t);
+        return ret;
+    }
+
     virtual antlrcpp::Any visitFile_input(Python3Parser::File_inputContext *ctx) override {
         return visitChildren(ctx);
     }
 
     virtual antlrcpp::Any visitFuncdef(Python3Parser::FuncdefContext *ctx) override {
-        functions[ctx->NAME()->getText()] = ctx;
+        const int id = symbolOf(ctx->NAME()->getSymbol());
+        functions[id] = ctx;
         if(ctx->parameters()->typedargslist()) {
-            vector<pair<string, DataType> > args;
+            vector<pair<int, DataType> > args;
             const auto def_Argument_List =  ctx->parameters()->typedargslist();
             const auto tests = def_Argument_List->test();
             for (int i = 0, siz = tests.size(), siz2 = def_Argument_List->tfpdef().size(); i < siz; i++) {
-                args.push_back(make_pair(def_Argument_List->tfpdef(siz2 - i - 1)->NAME()->getText(), visitTest(tests[tests.size() - i - 1]).as<DataType>()));
+                args.push_back(make_pair(symbolOf(def_Argument_List->tfpdef(siz2 - i - 1)->NAME()->getSymbol()), visitTest(tests[tests.size() - i - 1]).as<DataType>()));
             }
 
-            defaultArgs[ctx->NAME()->getText()] = args;
+            defaultArgs[id] = args;
         }
         return DataType(None);
     }
 
 
     virtual antlrcpp::Any visitStmt(Python3Parser::StmtContext *ctx) override { // suite only includes stmt or simple_stmt.
+        const FrameArena::Scope scratch(frameArena);
         if(ctx->simple_stmt()) return visitSimple_stmt(ctx->simple_stmt());
         if(ctx->compound_stmt()) return visitCompound_stmt(ctx->compound_stmt());
     }
@@ -53,10 +71,15 @@ class EvalVisitor: public Python3BaseVisitor {
     }
 
     virtual antlrcpp::Any visitExpr_stmt(Python3Parser::Expr_stmtContext *ctx) override {
+        if(auto append = dynamic_cast<AppendStmt*>(ctx)) {
+            antlrcpp::Any hr = visitTerm(append->operand);
+            vs[append->target].getContent() += hr.as<DataType>();
+            return DataType(None);
+        }
         if(ctx->augassign()) { // a ?= b
             const auto op = ctx->augassign()->getText();
             const auto hr = visitTest(ctx->testlist(1)->test(0)).as<DataType>();
-            const auto name = ctx->testlist(0)->test(0)->getText();
+            const int name = nameOf(ctx->testlist(0)->test(0));
             if(op == "+=") vs[name].getContent() += hr;
             else if(op == "-=") vs[name].getContent() -= hr;
             else if(op == "*=") vs[name].getContent() *= hr;
@@ -64,21 +87,21 @@ class EvalVisitor: public Python3BaseVisitor {
             else if(op == "//=") dualDivEqual(vs[name].getContent(), hr);
             else if(op == "%=") vs[name].getContent() %= hr;
         } else {
-            auto testLists = ctx->testlist();
+            auto testLists = childrenOf<Python3Parser::TestlistContext>(ctx);
             reverse(testLists.begin(), testLists.end());
             const auto ret = visitTestlist(testLists[0]);
             if(ret.is<DataType>()) {
-                vector<DataType> nums;
+                ArenaVector<DataType> nums;
                 nums.push_back(ret.as<DataType>());
                 for(unsigned i = 1; i < testLists.size(); i++) {
-                    const auto tests = testLists[i]->test();
-                    for(unsigned j = 0; j < tests.size(); j++) vs[tests[j]->getText()] = nums[j];
+                    const auto tests = childrenOf<Python3Parser::TestContext>(testLists[i]);
+                    for(unsigned j = 0; j < tests.size(); j++) vs[nameOf(tests[j])] = nums[j];
                 }
             } else {
                 const auto nums = ret.as<vector<DataType> >();
                 for(unsigned i = 1; i < testLists.size(); i++) {
-                    const auto tests = testLists[i]->test();
-                    for(unsigned j = 0; j < tests.size(); j++) vs[tests[j]->getText()] = nums[j];
+                    const auto tests = childrenOf<Python3Parser::TestContext>(testLists[i]);
+                    for(unsigned j = 0; j < tests.size(); j++) vs[nameOf(tests[j])] = nums[j];
                 }
             }
         }
@@ -115,8 +138,8 @@ class EvalVisitor: public Python3BaseVisitor {
     }
 
     virtual antlrcpp::Any visitIf_stmt(Python3Parser::If_stmtContext *ctx) override {
-        auto ls_test = ctx->test();
-        auto ls_suite = ctx->suite();
+        const auto ls_test = childrenOf<Python3Parser::TestContext>(ctx);
+        const auto ls_suite = childrenOf<Python3Parser::SuiteContext>(ctx);
         for(unsigned i = 0; i < ls_test.size(); i++) {
             if(visitTest(ls_test[i]).as<DataType>().toBool().data_Bool)
                     return visitSuite(ls_suite[i]);
@@ -125,10 +148,26 @@ class EvalVisitor: public Python3BaseVisitor {
         return DataType(None);
     }
 
-    virtual antlrcpp::Any visitWhile_stmt(Python3Parser::While_stmtContext *ctx) override {
+    // runs hot code natively on the current frame; hot is the region's entry in jit.
+    JitExit enterCompiled(Jit::Hotness &hot, antlr4::ParserRuleContext *root, DataType &result) {
+        if(!hot.region && !hot.rejected) jit.compile(hot, root, [](const string &nme) -> Variable& { return vs[nme]; });
+        if(!hot.region) return JitDeclined;
+        vector<Variable*> cells;
+        for(auto t: hot.region->ids) cells.push_back(&vs[t]);
+        return hot.region->run(cells, result);
+    }
+
+    antlrcpp::Any runWhile(Python3Parser::While_stmtContext *ctx, Jit::Hotness *hot = nullptr) {
         auto test = ctx->test();
         flowStk.push(Running);
-        while(visitTest(test).as<DataType>().toBool().data_Bool) {
+        while(1) {
+            const FrameArena::Scope scratch(frameArena);
+            if(hot && hot->tick(Jit::loopThreshold)) { // at an iteration boundary every variable is up to date
+                DataType result;
+                if(enterCompiled(*hot, ctx, result) == JitNone) break;
+                hot = nullptr; // it bailed out (or cannot run here): interpret the rest of this activation
+            }
+            if(!visitTest(test).as<DataType>().toBool().data_Bool) break;
             auto suite = ctx->suite();
             auto ret = visitSuite(suite);
             if(functionStk.query() == Returned) {
@@ -142,9 +181,70 @@ class EvalVisitor: public Python3BaseVisitor {
         return DataType(None);
     }
 
+    static bool holds(const long long &a, const size_t &op, const long long &b) {
+        switch(op) {
+            case Python3Parser::LESS_THAN: return a < b;
+            case Python3Parser::GREATER_THAN: return a > b;
+            case Python3Parser::LT_EQ: return a <= b;
+            default: return a >= b;
+        }
+    }
+
+    // the counter lives in a long long while it and the bound fit; the Variable is kept up to date for the body.
+    antlrcpp::Any runCounted(PlannedLoop *ctx, Jit::Hotness *hot) {
+        Variable &var = vs[ctx->counter];
+        long long cur, bound;
+        if(!var.isAssigned() || var.getContent().tpe != Int || !var.getContent().data_Int.toLongLong(cur)) return runWhile(ctx);
+        const DataType limit = visitArith_expr(ctx->cond->arith_expr(1)).as<DataType>();
+        if(limit.tpe != Int || !limit.data_Int.toLongLong(bound)) return runWhile(ctx);
+        DataType &cell = var.getContent();
+        const auto op = ctx->cond->comp_op(0)->getStart()->getType();
+        const auto ls = childrenOf<Python3Parser::StmtContext>(ctx->suite());
+        bool overflowed = 0;
+        flowStk.push(Running);
+        while(holds(cur, op, bound)) {
+            const FrameArena::Scope scratch(frameArena);
+            if(hot && hot->tick(Jit::loopThreshold)) {
+                flowStk.pop();
+                return runWhile(ctx, hot);
+            }
+            for(auto i: ls) {
+                if(flowStk.query() != Running) break;
+                if(i == ctx->step && !__builtin_add_overflow(cur, ctx->stride, &cur)) {
+                    cell.data_Int.fromLongLong(cur);
+                    continue;
+                }
+                overflowed = overflowed || i == ctx->step; // let BigInt take it from here
+                auto ret = visitStmt(i);
+                if(functionStk.query() == Returned) {
+                    flowStk.pop();
+                    return ret;
+                }
+            }
+            if(flowStk.query() == Broken) break;
+            flowStk.reset();
+            if(overflowed) {
+                flowStk.pop();
+                return runWhile(ctx);
+            }
+        }
+        flowStk.pop();
+        return DataType(None);
+    }
+
+    virtual antlrcpp::Any visitWhile_stmt(Python3Parser::While_stmtContext *ctx) override {
+        const auto plan = dynamic_cast<PlannedLoop*>(ctx);
+        if(!plan) return runWhile(ctx);
+        ++plan->generation; // hoisted values from an earlier activation are stale
+        Jit::Hotness *hot = jit.enabled ? &jit.hotness(plan) : nullptr;
+        auto ret = plan->step ? runCounted(plan, hot) : runWhile(plan, hot);
+        ++plan->generation;
+        return ret;
+    }
+
     virtual antlrcpp::Any visitSuite(Python3Parser::SuiteContext *ctx) override {
         if(ctx->simple_stmt()) return visitSimple_stmt(ctx->simple_stmt());
-        const auto ls = ctx->stmt();
+        const auto ls = childrenOf<Python3Parser::StmtContext>(ctx);
         for(auto i: ls) {
             if(flowStk.query() != Running) break;
             auto ret = visitStmt(i);
@@ -158,7 +258,7 @@ class EvalVisitor: public Python3BaseVisitor {
     }
 
     virtual antlrcpp::Any visitOr_test(Python3Parser::Or_testContext *ctx) override {
-        const auto ls = ctx->and_test();
+        const auto ls = childrenOf<Python3Parser::And_testContext>(ctx);
         if((signed)ls.size() == 1) return visitAnd_test(ls[0]);
         for(auto i: ls) {
             DataType rt = visitAnd_test(i).as<DataType>();
@@ -168,7 +268,7 @@ class EvalVisitor: public Python3BaseVisitor {
     }
 
     virtual antlrcpp::Any visitAnd_test(Python3Parser::And_testContext *ctx) override {
-        const auto ls = ctx->not_test();
+        const auto ls = childrenOf<Python3Parser::Not_testContext>(ctx);
         if((signed) ls.size() == 1) return visitNot_test(ls[0]);
         for(auto i: ls) {
             DataType rt = visitNot_test(i).as<DataType>();
@@ -185,9 +285,9 @@ class EvalVisitor: public Python3BaseVisitor {
     }
 
     virtual antlrcpp::Any visitComparison(Python3Parser::ComparisonContext *ctx) override {
-        const auto ops = ctx->comp_op();
+        const auto ops = childrenOf<Python3Parser::Comp_opContext>(ctx);
         if(!ops.size()) return visitArith_expr(ctx->arith_expr(0));
-        const auto ariths = ctx->arith_expr();
+        const auto ariths = childrenOf<Python3Parser::Arith_exprContext>(ctx);
         DataType hl, hr = visitArith_expr(ariths[0]).as<DataType>();
         for(unsigned i = 0; i < ops.size(); i++) {
             hl = hr, hr = visitArith_expr(ariths[i + 1]).as<DataType>();
@@ -213,8 +313,8 @@ class EvalVisitor: public Python3BaseVisitor {
 
 
     virtual antlrcpp::Any visitArith_expr(Python3Parser::Arith_exprContext *ctx) override {
-        const auto list_ops = ctx->addsub_op();
-        const auto list_nums = ctx->term();
+        const auto list_ops = childrenOf<Python3Parser::Addsub_opContext>(ctx);
+        const auto list_nums = childrenOf<Python3Parser::TermContext>(ctx);
         if(!list_ops.size()) return visitTerm(list_nums[0]);
         auto ret = visitTerm(list_nums[0]).as<DataType>();
         for(unsigned i = 0; i < list_ops.size(); i++) {
@@ -226,8 +326,8 @@ class EvalVisitor: public Python3BaseVisitor {
     }
 
     virtual antlrcpp::Any visitTerm(Python3Parser::TermContext *ctx) override {
-        const auto list_ops = ctx->muls_op();
-        const auto list_nums = ctx->factor();
+        const auto list_ops = childrenOf<Python3Parser::Muls_opContext>(ctx);
+        const auto list_nums = childrenOf<Python3Parser::FactorContext>(ctx);
         if(!list_ops.size()) return visitFactor(list_nums[0]);
         auto ret = visitFactor(list_nums[0]).as<DataType>();
         for(unsigned i = 0; i < list_ops.size(); i++) {
@@ -249,56 +349,182 @@ class EvalVisitor: public Python3BaseVisitor {
 
     virtual antlrcpp::Any visitAtom_expr(Python3Parser::Atom_exprContext *ctx) override {
         if(!ctx->trailer()) return visitAtom(ctx->atom());
-        const string function_Name = ctx->atom()->getText();
-        if(function_Name == "print") {
+        if(isSubscript(ctx->trailer())) return subscript(ctx);
+        const int function_Name = nameOf(ctx->atom());
+        const bool builtin = SymbolTable::isBuiltin(function_Name) && !(symbols.isShadowed(function_Name) && functions.count(function_Name));
+        if(builtin && function_Name == SymbolTable::Print) {
             if(ctx->trailer()->arglist()) {
-                const auto provided_Argument_List = ctx->trailer()->arglist()->argument();
+                const auto provided_Argument_List = childrenOf<Python3Parser::ArgumentContext>(ctx->trailer()->arglist());
                 for(unsigned i = 0; i < provided_Argument_List.size(); i++) {
                     const auto data = visitTest(provided_Argument_List[i]->test()).as<DataType>();
-                    cout << data.toPrint();
-                    if(i != provided_Argument_List.size() - 1) cout << " ";
+                    data.printTo(OutputWriter::instance());
+                    if(i != provided_Argument_List.size() - 1) OutputWriter::instance().put(' ');
                 }
             }
-            cout << endl;
+            OutputWriter::instance().endLine();
             return DataType(None);
-        } else if(function_Name == "int" || function_Name == "float" || function_Name == "str" || function_Name == "bool") {
+        } else if(builtin) {
             const auto only = visitTest(ctx->trailer()->arglist()->argument(0)->test()).as<DataType>();
-            if(function_Name == "int") return only.toInt();
-            if(function_Name == "float") return only.toFloat();
-            if(function_Name == "str") return only.toString();
-            if(function_Name == "bool") return only.toBool();
+            if(function_Name == SymbolTable::Int) return only.toInt();
+            if(function_Name == SymbolTable::Float) return only.toFloat();
+            if(function_Name == SymbolTable::Str) return only.toString();
+            if(function_Name == SymbolTable::Bool) return only.toBool();
+            if(function_Name == SymbolTable::Len) return only.len();
         } else {
-            map<string, Variable> new_Argument_List;
-            if(functions[function_Name]->parameters()->typedargslist()) { // push arguments.
-                const auto def_Argument_List =  functions[function_Name]->parameters()->typedargslist();
-                const auto arg2 = defaultArgs[function_Name];
-                for(auto i: arg2) new_Argument_List[i.first] = i.second;
+            const FrameArena::Scope frame(frameArena); // the callee's scratch and its arguments'
+            Frame new_Argument_List;
+            const auto callee = functions[function_Name];
+            if(callee->parameters()->typedargslist()) { // push arguments.
+                const auto def_Argument_List =  callee->parameters()->typedargslist();
+                const auto &arg2 = defaultArgs[function_Name];
+                for(auto &i: arg2) new_Argument_List[i.first] = i.second;
                 if(ctx->trailer()->arglist()) {
-                    const auto provided_Argument_List = ctx->trailer()->arglist()->argument();
+                    const auto provided_Argument_List = childrenOf<Python3Parser::ArgumentContext>(ctx->trailer()->arglist());
                     int i;
                     for (i = 0; i < provided_Argument_List.size(); i++) {
                         const auto t = provided_Argument_List[i];
                         if (t->NAME()) break;
-                        const string name = def_Argument_List->tfpdef(i)->getText();
-                        new_Argument_List[name] = visitTest(t->test()).as<DataType>();
+                        new_Argument_List[nameOf(def_Argument_List->tfpdef(i))] = visitTest(t->test()).as<DataType>();
                     }
                     for (; i < provided_Argument_List.size(); i++) {
                         const auto t = provided_Argument_List[i];
-                        new_Argument_List[t->NAME()->getText()] = visitTest(t->test()).as<DataType>();
+                        new_Argument_List[symbolOf(t->NAME()->getSymbol())] = visitTest(t->test()).as<DataType>();
                     }
                 }
             }
             vs.push(0), vs.merge(new_Argument_List), functionStk.push(Running);
-            auto ret = visitSuite(functions[function_Name]->suite());
+            if(jit.enabled) {
+                auto &hot = jit.hotness(callee);
+                DataType result;
+                if(hot.tick(Jit::callThreshold) && enterCompiled(hot, callee, result) < JitBail) {
+                    vs.pop(), functionStk.pop();
+                    return result;
+                }
+            }
+            auto ret = visitSuite(callee->suite());
             vs.pop(), functionStk.pop();
             return ret;
         }
     }
 
 
+    // x[i] or x[a:b], the trailer being '[' test? (':' test?)? ']'.
+    DataType subscript(Python3Parser::Atom_exprContext *ctx) {
+        antlrcpp::Any value = visitAtom(ctx->atom());
+        DataType bounds[2] = {DataType(None), DataType(None)};
+        bool isSlice = 0;
+        const auto &ch = ctx->trailer()->children;
+        for(unsigned i = 1; i + 1 < ch.size(); i++) {
+            if(auto test = dynamic_cast<Python3Parser::TestContext*>(ch[i])) bounds[isSlice] = visitTest(test).as<DataType>();
+            else isSlice = 1;
+        }
+        const DataType &x = value.as<DataType>();
+        return isSlice ? x.slice(bounds[0], bounds[1]) : x.index(bounds[0]);
+    }
+
+    static inline bool isArith(const DataType &x) {
+        return x.tpe == Int || x.tpe == Float;
+    }
+
+    static inline double arithValue(const DataType &x) { // what toFloat() would give for an Int/Float
+        return x.tpe == Float ? x.data_Float : x.data_Int.toDouble();
+    }
+
+    // Specialized atoms stand for expressions TypeInferer proved to have Int/Float operands only,
+    // so they skip fixType and the by-value DataType operators. Any other tag falls back to them.
+    DataType specializedArith(Python3Parser::Arith_exprContext *ctx) {
+        const auto list_ops = childrenOf<Python3Parser::Addsub_opContext>(ctx);
+        const auto list_nums = childrenOf<Python3Parser::TermContext>(ctx);
+        DataType ret = visitTerm(list_nums[0]).as<DataType>();
+        for(unsigned i = 0; i < list_ops.size(); i++) {
+            antlrcpp::Any val = visitTerm(list_nums[i + 1]);
+            const DataType &hr = val.as<DataType>();
+            const bool add = list_ops[i]->getStart()->getType() == Python3Parser::ADD;
+            if(ret.tpe == Int && hr.tpe == Int) ret.data_Int = add ? ret.data_Int + hr.data_Int : ret.data_Int - hr.data_Int;
+            else if(isArith(ret) && isArith(hr)) ret = DataType(add ? arithValue(ret) + arithValue(hr) : arithValue(ret) - arithValue(hr));
+            else ret = add ? ret + hr : ret - hr;
+        }
+        return ret;
+    }
+
+    DataType specializedTerm(Python3Parser::TermContext *ctx) {
+        const auto list_ops = childrenOf<Python3Parser::Muls_opContext>(ctx);
+        const auto list_nums = childrenOf<Python3Parser::FactorContext>(ctx);
+        DataType ret = visitFactor(list_nums[0]).as<DataType>();
+        for(unsigned i = 0; i < list_ops.size(); i++) {
+            antlrcpp::Any val = visitFactor(list_nums[i + 1]);
+            const DataType &hr = val.as<DataType>();
+            const auto op = list_ops[i]->getStart()->getType();
+            if(ret.tpe == Int && hr.tpe == Int) {
+                if(op == Python3Parser::STAR) ret.data_Int = ret.data_Int * hr.data_Int;
+                else if(op == Python3Parser::DIV) ret = DataType(ret.data_Int.toDouble() / hr.data_Int.toDouble());
+                else if(op == Python3Parser::IDIV) ret.data_Int = ret.data_Int / hr.data_Int;
+                else ret.data_Int = ret.data_Int % hr.data_Int;
+            } else if(isArith(ret) && isArith(hr) && (op == Python3Parser::STAR || op == Python3Parser::DIV)) {
+                ret = DataType(op == Python3Parser::STAR ? arithValue(ret) * arithValue(hr) : arithValue(ret) / arithValue(hr));
+            } else {
+                if(op == Python3Parser::STAR) ret = ret * hr;
+                else if(op == Python3Parser::DIV) ret = ret / hr;
+                else if(op == Python3Parser::IDIV) ret = dualDiv(ret, hr);
+                else ret = ret % hr;
+            }
+        }
+        return ret;
+    }
+
+    static inline bool compareArith(const DataType &hl, const DataType &hr, size_t op) {
+        if(hl.tpe == Int && hr.tpe == Int) {
+            if(op == Python3Parser::EQUALS) return hl.data_Int == hr.data_Int;
+            if(op == Python3Parser::NOT_EQ_2) return hl.data_Int != hr.data_Int;
+            if(op == Python3Parser::LESS_THAN) return hl.data_Int < hr.data_Int;
+            if(op == Python3Parser::GREATER_THAN) return hl.data_Int > hr.data_Int;
+            if(op == Python3Parser::LT_EQ) return hl.data_Int <= hr.data_Int;
+            return hl.data_Int >= hr.data_Int;
+        }
+        if(isArith(hl) && isArith(hr)) {
+            const double a = arithValue(hl), b = arithValue(hr);
+            if(op == Python3Parser::EQUALS) return a == b;
+            if(op == Python3Parser::NOT_EQ_2) return a != b;
+            if(op == Python3Parser::LESS_THAN) return a < b;
+            if(op == Python3Parser::GREATER_THAN) return a > b;
+            if(op == Python3Parser::LT_EQ) return a <= b;
+            return a >= b;
+        }
+        if(op == Python3Parser::EQUALS) return hl == hr;
+        if(op == Python3Parser::NOT_EQ_2) return hl != hr;
+        if(op == Python3Parser::LESS_THAN) return hl < hr;
+        if(op == Python3Parser::GREATER_THAN) return hl > hr;
+        if(op == Python3Parser::LT_EQ) return hl <= hr;
+        return hl >= hr;
+    }
+
+    DataType specializedComparison(Python3Parser::ComparisonContext *ctx) {
+        const auto ops = childrenOf<Python3Parser::Comp_opContext>(ctx);
+        const auto ariths = childrenOf<Python3Parser::Arith_exprContext>(ctx);
+        DataType hl, hr = visitArith_expr(ariths[0]).as<DataType>();
+        for(unsigned i = 0; i < ops.size(); i++) {
+            hl = hr, hr = visitArith_expr(ariths[i + 1]).as<DataType>();
+            if(!compareArith(hl, hr, ops[i]->getStart()->getType())) return DataType((bool) 0);
+        }
+        return DataType((bool) 1);
+    }
+
+    antlrcpp::Any visitSynthetic(SyntheticAtom *ctx) {
+        if(ctx->kind == Constant) return ctx->value;
+        if(ctx->kind == Hoisted) {
+            if(ctx->seen != ctx->loop->generation) ctx->value = visit(ctx->origin).as<DataType>(), ctx->seen = ctx->loop->generation;
+            return ctx->value;
+        }
+        const auto rule = ctx->origin->getRuleIndex();
+        if(rule == Python3Parser::RuleArith_expr) return specializedArith(static_cast<Python3Parser::Arith_exprContext*>(ctx->origin));
+        if(rule == Python3Parser::RuleTerm) return specializedTerm(static_cast<Python3Parser::TermContext*>(ctx->origin));
+        return specializedComparison(static_cast<Python3Parser::ComparisonContext*>(ctx->origin));
+    }
+
     virtual antlrcpp::Any visitAtom(Python3Parser::AtomContext *ctx) override {
-        const string text = ctx->getText();
-        if(ctx->NAME()) return vs[text].getContent(); // it must be a variable.
+        if(isSynthetic(ctx)) return visitSynthetic(static_cast<SyntheticAtom*>(ctx));
+        if(auto name = ctx->NAME()) return vs[symbolOf(name->getSymbol())].getContent(); // it must be a variable.
+        const string text = textOf(ctx);
         if(ctx->NUMBER()) {
             if(text.find('.') != text.npos) {
                 double a = 0;
@@ -324,7 +550,7 @@ class EvalVisitor: public Python3BaseVisitor {
         if(text == "None") return DataType(None);
     }
     virtual antlrcpp::Any visitTestlist(Python3Parser::TestlistContext *ctx) override { // return an vector of DataType
-        const auto tests = ctx->test();
+        const auto tests = childrenOf<Python3Parser::TestContext>(ctx);
         if(tests.size() == 1) return visitTest(tests[0]);
         vector<DataType> ret;
         for(auto i: tests) ret.push_back(visitTest(i).as<DataType>());
@@ -0,0 +1,95 @@
+#ifndef PYTHON_INTERPRETER_CACHEFILE_HPP
+#define PYTHON_INTERPRETER_CACHEFILE_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+using namespace std;
+
+// Binary encoding and file handling shared by the on-disk caches (--dfa-cache, --program-cache).
+// Numbers are stored in the machine's byte order: a cache is only read back by the build that can write it.
+
+class CacheWriter {
+public:
+    string out;
+    void u8(uint8_t x) {out += (char) x;}
+    void u32(uint32_t x) {out.append((const char*) &x, 4);}
+    void u64(uint64_t x) {out.append((const char*) &x, 8);}
+    void str(const string &x) {u64(x.size()), out += x;}
+    void varint(uint64_t x) { // LEB128: 7 bits a byte, low bits first
+        for(; x >= 0x80; x >>= 7) out += (char) (x | 0x80);
+        out += (char) x;
+    }
+};
+
+// Reads past the end leave ok at 0 and return zeros, so a truncated file is noticed once, after the fact.
+class CacheReader {
+private:
+    const string &in;
+    size_t at;
+    template<class T> T get() {
+        T x = 0;
+        if(in.size() - at < sizeof x) return ok = 0, x;
+        memcpy(&x, in.data() + at, sizeof x), at += sizeof x;
+        return x;
+    }
+public:
+    bool ok;
+    explicit CacheReader(const string &_in): in(_in), at(0), ok(1) {}
+    uint8_t u8() {return get<uint8_t>();}
+    uint32_t u32() {return get<uint32_t>();}
+    uint64_t u64() {return get<uint64_t>();}
+    string bytes(size_t n) {
+        if(in.size() - at < n) return ok = 0, "";
+        return at += n, in.substr(at - n, n);
+    }
+    string str() {
+        const uint64_t n = u64();
+        return bytes(n > in.size() ? in.size() + 1 : n);
+    }
+    uint64_t varint() {
+        uint64_t x = 0;
+        for(unsigned shift = 0; shift < 64; shift += 7) {
+            if(at == in.size()) break;
+            const unsigned char c = in[at++];
+            x |= (uint64_t) (c & 0x7F) << shift;
+            if(!(c & 0x80)) return x;
+        }
+        return ok = 0, 0;
+    }
+    bool done() const {return at == in.size();}
+};
+
+inline uint64_t fnv1a(const void *data, size_t n, uint64_t h = 14695981039346656037ULL) {
+    const unsigned char *s = (const unsigned char*) data;
+    for(size_t i = 0; i < n; i++) h = (h ^ s[i]) * 1099511628211ULL;
+    return h;
+}
+
+inline bool readCacheFile(const string &path, string &ret) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if(!f) return 0;
+    ret.clear();
+    char chunk[1 << 16];
+    for(size_t k; (k = fread(chunk, 1, sizeof chunk, f)) > 0; ) ret.append(chunk, k);
+    const bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+// writes a temporary file next to path and renames it over path, so concurrent readers see the old file or the new one.
+inline bool writeCacheFile(const string &path, const string &data) {
+    const string temp = path + ".tmp" + to_string(getpid());
+    FILE *f = fopen(temp.c_str(), "wb");
+    if(!f) return 0;
+    const bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    if(fclose(f) || !ok || rename(temp.c_str(), path.c_str())) {
+        remove(temp.c_str());
+        return 0;
+    }
+    return 1;
+}
+
+#endif //PYTHON_INTERPRETER_CACHEFILE_HPP
@@ -0,0 +1,139 @@
+#ifndef PYTHON_INTERPRETER_COMPACTTOKENS_HPP
+#define PYTHON_INTERPRETER_COMPACTTOKENS_HPP
+
+#include "antlr4-runtime.h"
+#include "Python3Parser.h"
+#include "sourceStream.hpp"
+#include "symbolTable.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+using namespace std;
+
+// The tokens of one source, a column per field: 22 bytes a token, and no text, which stays in the source buffer.
+// A NAME is interned as it is added, its symbol id kept in a column. Streams and trees see them through
+// CompactToken handles: ANTLR's token streams and terminal nodes hold antlr4::Token pointers, so each row still
+// gets an object, but it holds no field of its own, only where the row is.
+class TokenTable {
+private:
+    friend class CompactToken;
+    antlr4::TokenSource *source;
+    Utf8CharStream *input;
+    vector<int16_t> types; // EOF is -1, as size_t(-1) truncated
+    vector<int32_t> starts, stops; // code point indexes; an EOF token stops at start - 1
+    vector<uint32_t> lines, columns;
+    vector<int32_t> ids; // symbol ids of NAMEs, -1 for other tokens
+
+public:
+    TokenTable(): source(nullptr), input(nullptr) {}
+
+    // where the tokens added from now on come from.
+    void bind(antlr4::TokenSource *_source, Utf8CharStream *_input) {
+        source = _source, input = _input;
+    }
+    // the new token's index.
+    size_t add(size_t type, size_t start, size_t stop, size_t line, size_t column) {
+        types.push_back(type), starts.push_back(start), stops.push_back(stop), lines.push_back(line), columns.push_back(column);
+        int id = -1;
+        if(type == Python3Parser::NAME && input) {
+            size_t length;
+            const char *name = input->text(start, stop, length);
+            id = symbols.intern(name, length);
+        }
+        ids.push_back(id);
+        return types.size() - 1;
+    }
+    size_t size() const {
+        return types.size();
+    }
+    // drops every row; no handle to them may be left.
+    void clear() {
+        types.clear(), starts.clear(), stops.clear(), lines.clear(), columns.clear(), ids.clear();
+    }
+    size_t bytes() const { // the columns' capacity
+        return types.capacity() * sizeof(int16_t) + (starts.capacity() + stops.capacity() + ids.capacity()) * sizeof(int32_t)
+               + (lines.capacity() + columns.capacity()) * sizeof(uint32_t);
+    }
+};
+
+// A token as a row of a TokenTable. Its index in the table is its token index, so a table must feed one stream,
+// in order. Handles are placed by a ParseArena: deleting one, as token streams do, leaves the memory to the arena.
+class CompactToken final: public antlr4::Token {
+private:
+    const TokenTable *table;
+    size_t index;
+
+    static size_t widen(int64_t x) { // keeps -1 as ANTLR's size_t(-1)
+        return (size_t) x;
+    }
+
+public:
+    CompactToken(const TokenTable *_table, size_t _index): table(_table), index(_index) {}
+    static void* operator new(size_t, void *where) {
+        return where;
+    }
+    static void operator delete(void*, void*) {}
+    static void operator delete(void*) {}
+
+    // the text in place, for callers that need no copy; what getText gives.
+    const char* text(size_t &length) const {
+        const size_t start = getStartIndex(), stop = getStopIndex(), n = table->input ? table->input->size() : 0;
+        if(start >= n || stop >= n) {
+            length = table->input ? 5 : 0;
+            return "<EOF>";
+        }
+        return table->input->text(start, stop, length);
+    }
+    // the symbol id of a NAME, -1 for other tokens.
+    int symbol() const {
+        return table->ids[index];
+    }
+    string getText() const override {
+        size_t length;
+        const char *ret = text(length);
+        return string(ret, length);
+    }
+    size_t getType() const override {
+        return widen(table->types[index]);
+    }
+    size_t getLine() const override {
+        return table->lines[index];
+    }
+    size_t getCharPositionInLine() const override {
+        return table->columns[index];
+    }
+    size_t getChannel() const override {
+        return antlr4::Token::DEFAULT_CHANNEL;
+    }
+    size_t getTokenIndex() const override {
+        return index;
+    }
+    size_t getStartIndex() const override {
+        return widen(table->starts[index]);
+    }
+    size_t getStopIndex() const override {
+        return widen(table->stops[index]);
+    }
+    antlr4::TokenSource* getTokenSource() const override {
+        return table->source;
+    }
+    antlr4::CharStream* getInputStream() const override {
+        return table->input;
+    }
+    string toString() const override { // as CommonToken's
+        string txt = getText();
+        if(txt.empty()) txt = "<no text>";
+        string escaped;
+        for(char c: txt) escaped += c == '\n' ? "\\n" : c == '\r' ? "\\r" : c == '\t' ? "\\t" : string(1, c);
+        return "[@" + to_string(index) + "," + to_string(table->starts[index]) + ":" + to_string(table->stops[index]) + "='" + escaped
+               + "',<" + to_string(table->types[index]) + ">," + to_string(getLine()) + ":" + to_string(getCharPositionInLine()) + "]";
+    }
+};
+
+// the symbol id of a NAME token, however it was made: interned at lexing for CompactTokens, by text otherwise.
+inline int symbolOf(const antlr4::Token *t) {
+    if(typeid(*t) == typeid(CompactToken)) return static_cast<const CompactToken*>(t)->symbol();
+    return symbols.intern(t->getText());
+}
+
+#endif //PYTHON_INTERPRETER_COMPACTTOKENS_HPP
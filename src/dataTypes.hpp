@@ -9,10 +9,19 @@
 #include <cstdio>
 #include <cstring>
 #include <algorithm>
+#include <deque>
 #include <cctype>
 #include <vector>
 #include <set>
+#include <map>
+#include <string>
 #include <cmath>
+#include <stdexcept>
+#include "floatFormat.hpp"
+#include "slabAllocator.hpp"
+#include "digitPool.hpp"
+#include "symbolTable.hpp"
+#include "sharedString.hpp"
 #ifndef debug
 #define debug cerr
 #endif
@@ -24,7 +33,7 @@ inline int dcmp(const double &a, const double &b) {
 
 class BigInt {
 private:
-    vector<int> dat;
+    vector<int, DigitAllocator<int> > dat;
     bool isNeg; // isNeg will be zero for 0.
     inline int length() const {
         return dat.size();
@@ -35,9 +44,14 @@ private:
     inline const int operator [] (const int &x) const {
         return x < dat.size() ? dat[x] : 0;
     }
+    inline void trim() { // drops the leading zeros with a single resize
+        int k = length();
+        while(k && !dat[k - 1]) k--;
+        dat.resize(k);
+    }
     inline BigInt octShl(int x) const {
         BigInt ret;
-        ret.isNeg = isNeg;
+        ret.isNeg = isNeg, ret.dat.reserve(x + length());
         for(int i = 0; i < x; i++) ret.dat.push_back(0);
         for(int i = 0; i < dat.size(); i++) ret.dat.push_back(dat[i]);
         return ret;
@@ -53,14 +67,15 @@ public:
     }
     BigInt(int x) {
         isNeg = 0;
+        if(x) dat.reserve(10);
         while(x) dat.push_back(x % 10), x /= 10;
         reverse(dat.begin(), dat.end());
     }
     BigInt(const string &s) {
-        isNeg = 0;
+        isNeg = 0, dat.reserve(s.length());
         for(int i = 0; i < s.length(); i++) dat.push_back(s[i] - '0');
         reverse(dat.begin(), dat.end());
-        while(length() && !dat[length() - 1]) dat.resize(length() - 1);
+        trim();
         if(!length()) isNeg = 0;
     }
     friend bool operator == (const BigInt &a, const BigInt &b) {
@@ -105,21 +120,21 @@ public:
                 ret[i] += a[i] + b[i];
                 ret[i + 1] += ret[i] / 10, ret[i] %= 10;
             }
-            while(ret.length() && !ret[ret.length() - 1]) ret.dat.resize(ret.length() - 1);
+            ret.trim();
         } else {
             if(cmpAbs(b, a)) { // a >= b
                 for(int i = 0; i < max(a.length(), b.length()) + 10; i++) {
                     ret[i] += a[i] - b[i];
                     if (ret[i] < 0) ret[i] += 10, ret[i + 1]--;
                 }
-                while(ret.length() && !ret[ret.length() - 1]) ret.dat.resize(ret.length() - 1);
+                ret.trim();
             } else { // otherwise
                 ret.isNeg = b.isNeg;
                 for(int i = 0; i < max(a.length(), b.length()) + 10; i++) {
                     ret[i] += b[i] - a[i];
                     if (ret[i] < 0) ret[i] += 10, ret[i + 1]--;
                 }
-                while(ret.length() && !ret[ret.length() - 1]) ret.dat.resize(ret.length() - 1);
+                ret.trim();
             }
         }
         if(!ret.length()) ret.isNeg = 0;
@@ -134,7 +149,8 @@ public:
         ret.dat.resize(a.length() + b.length() + 10);
         for(int i = 0; i < a.length(); i++) for(int j = 0; j < b.length(); j++) ret[i + j] += a[i] * b[j];
         for(int i = 0; i < ret.length() - 1; i++) ret[i + 1] += ret[i] / 10, ret[i] %= 10;
-        while(ret.length() && !ret[ret.length() - 1]) ret.dat.resize(ret.length() - 1);
+        ret.trim();
+        if(!ret.length()) ret.isNeg = 0;
         return ret;
     }
     friend BigInt operator / (BigInt a, BigInt b) {
@@ -146,11 +162,12 @@ public:
             BigInt temp = b.octShl(i);
             while(temp <= a) a -= temp, ++ret[i];
         }
-        while(ret.length() && !ret[ret.length() - 1]) ret.dat.resize(ret.length() - 1);
+        ret.trim();
         if(flag) {
             ret.isNeg = 1;
             if(a.length()) --ret;
         }
+        if(!ret.length()) ret.isNeg = 0;
         return ret;
     }
     friend BigInt operator % (const BigInt &a, const BigInt &b) {
@@ -188,26 +205,53 @@ public:
         long long x = xx;
         isNeg = 0, dat.clear();
         if(x < 0) isNeg = 1, x = -x;
+        if(x) dat.reserve(19);
         while(x) dat.push_back(x % 10), x /= 10;
-        while(length() && !dat[length() - 1]) dat.resize(length() - 1);
+        trim();
         if(!length()) isNeg = 0;
     }
+    inline bool toLongLong(long long &x) const { // 18 digits always fit.
+        if(length() > 18) return 0;
+        x = 0;
+        for(int i = length() - 1; ~i; i--) x = x * 10 + dat[i];
+        if(isNeg) x = -x;
+        return 1;
+    }
+    inline void fromLongLong(const long long &x) {
+        unsigned long long y = x < 0 ? -(unsigned long long)x : x;
+        isNeg = x < 0, dat.clear();
+        if(y) dat.reserve(20);
+        while(y) dat.push_back(y % 10), y /= 10;
+    }
     inline string toString() const {
         if(!length()) return "0";
         string ret = isNeg ? "-" : "";
         for(int i = length() - 1; ~i; i--) ret = ret + (char)('0' + dat[i]);
         return ret;
     }
+    template <class Writer>
+    void printTo(Writer &out) const { // digits straight into the writer's buffer
+        if(!length()) return out.put('0');
+        char *p = out.reserve(length() + 1);
+        if(!p) return out.write(toString());
+        int k = 0;
+        if(isNeg) p[k++] = '-';
+        for(int i = length() - 1; ~i; i--) p[k++] = '0' + dat[i];
+        out.commit(k);
+    }
     inline void fromString(const string &s) {
-        isNeg = 0, dat.clear();
+        isNeg = 0, dat.clear(), dat.reserve(s.length());
         for(int i = 0; i < s.length(); i++) dat.push_back(s[i] - '0');
         reverse(dat.begin(), dat.end());
-        while(length() && !dat[length() - 1]) dat.resize(length() - 1);
+        trim();
         if(!length()) isNeg = 0;
     }
     inline bool toBool() const {
         return (bool) length();
     }
+    inline bool negative() const {
+        return isNeg;
+    }
     inline void fromBool(const bool &t) {
         isNeg = 0, dat.clear();
         if(t) dat.push_back(1);
@@ -240,19 +284,20 @@ public:
     bool data_Bool;
     BigInt data_Int;
     double data_Float;
-    string data_String;
+    SharedString data_String;
     DataType() {data_Bool = 0, data_Float = 0;}
     explicit DataType(const Type &_tpe) {tpe = _tpe, data_Bool = 0, data_Float = 0;}
     explicit DataType(const bool &x) {tpe = Bool, data_Bool = x;}
     explicit DataType(const BigInt &x) {tpe = Int, data_Int = x;}
     explicit DataType(const double &x) {tpe = Float, data_Float = x;}
     explicit DataType(const string &x) {tpe = String, data_String = x;}
+    explicit DataType(const SharedString &x) {tpe = String, data_String = x;}
     inline DataType toInt() const {
         if(tpe == Int) return *this;
         DataType ret(Int);
         if(tpe == Bool) ret.data_Int.fromBool(data_Bool);
         else if(tpe == Float) ret.data_Int.fromDouble(data_Float);
-        else if(tpe == String) ret.data_Int.fromString(data_String);
+        else if(tpe == String) ret.data_Int.fromString(data_String.str());
         return ret;
     }
     inline DataType toFloat() const {
@@ -269,9 +314,8 @@ public:
         if(tpe == Bool) ret.data_String = data_Bool ? "True" : "False";
         if(tpe == Int) ret.data_String = data_Int.toString();
         if(tpe == Float) {
-            static char buf[1010];
-            sprintf(buf, "%0.6f", data_Float);
-            ret.data_String = string(buf);
+            char buf[fixedBufferSize];
+            ret.data_String = string(buf, formatFixed6(data_Float, buf));
         }
         return ret;
     }
@@ -284,16 +328,55 @@ public:
         return ret;
     }
     inline string toPrint() const {
-        if(getType() == String) return data_String;
+        if(getType() == String) return data_String.str();
         if(getType() == Int) return data_Int.toString();
         if(getType() == Bool) return data_Bool ? "True" : "False";
         if(getType() == None) return "None";
-        static char buf[1010];
         if(getType() == Float) {
-            sprintf(buf, "%0.6f", data_Float);
-            return (string) buf;
+            char buf[fixedBufferSize];
+            return string(buf, formatFixed6(data_Float, buf));
         }
     }
+    template <class Writer>
+    void printTo(Writer &out) const { // same text as toPrint()
+        if(getType() == String) out.write(data_String.data(), data_String.length());
+        else if(getType() == Int) data_Int.printTo(out);
+        else if(getType() == Bool) out.write(data_Bool ? "True" : "False", data_Bool ? 4 : 5);
+        else if(getType() == None) out.write("None", 4);
+        else if(getType() == Float) {
+            char *p = out.reserve(fixedBufferSize);
+            out.commit(formatFixed6(data_Float, p));
+        }
+    }
+    // len(x), in code points.
+    DataType len() const {
+        if(tpe != String) throw invalid_argument("len() of a value that is not a string");
+        DataType ret(Int);
+        ret.data_Int.fromLongLong(data_String.codePoints());
+        return ret;
+    }
+    // x[i]; a negative i counts from the end.
+    DataType index(const DataType &i) const {
+        if(tpe != String) throw invalid_argument("subscript of a value that is not a string");
+        const long long n = data_String.codePoints();
+        long long k;
+        if(!i.toInt().data_Int.toLongLong(k) || (k < 0 && (k += n) < 0) || k >= n) throw out_of_range("string index out of range");
+        return DataType(data_String.slice(k, k + 1));
+    }
+    // x[from:to]; a None bound is the start or the end, others are clamped to the string as Python does.
+    DataType slice(const DataType &from, const DataType &to) const {
+        if(tpe != String) throw invalid_argument("subscript of a value that is not a string");
+        const long long n = data_String.codePoints();
+        const auto bound = [n](const DataType &x, long long absent) {
+            if(x.tpe == None) return absent;
+            const BigInt k = x.toInt().data_Int;
+            long long ret;
+            if(!k.toLongLong(ret)) return k < BigInt(0) ? 0ll : n;
+            if(ret < 0) ret += n;
+            return ret < 0 ? 0ll : ret > n ? n : ret;
+        };
+        return DataType(data_String.slice(bound(from, 0), bound(to, n)));
+    }
     friend DataType operator + (DataType a, DataType b) {
         fixType2(a, b);
         if(a.getType() == Int) return DataType(a.data_Int + b.data_Int);
@@ -305,18 +388,24 @@ public:
         if(a.getType() == Int) return DataType(a.data_Int - b.data_Int);
         if(a.getType() == Float) return DataType(a.data_Float - b.data_Float);
     }
+    // s * times: sized once, then filled by doubling the part already copied.
+    static DataType repeat(const SharedString &s, const BigInt &times) {
+        DataType ret(String);
+        long long n;
+        if(s.empty() || times <= BigInt(0)) return ret;
+        string t;
+        if(!times.toLongLong(n) || (unsigned long long) n > t.max_size() / s.length())
+            throw length_error("repeated string is too long");
+        t.resize(s.length() * n);
+        memcpy(&t[0], s.data(), s.length());
+        for(size_t done = s.length(); done < t.length(); done *= 2) memcpy(&t[done], &t[0], min(done, t.length() - done));
+        ret.data_String = move(t);
+        return ret;
+    }
     friend DataType operator * (DataType a, DataType b) {
-        if(a.getType() == String) {
-            string ret = "";
-            for(BigInt i = 1, t = b.toInt().data_Int; i <= t; i++) ret = ret + a.data_String;
-            return DataType(ret);
-        }
+        if(a.getType() == String) return repeat(a.data_String, b.toInt().data_Int);
         swap(a, b);
-        if(a.getType() == String) {
-            string ret = "";
-            for(BigInt i = 1, t = b.toInt().data_Int; i <= t; i++) ret = ret + a.data_String;
-            return DataType(ret);
-        }
+        if(a.getType() == String) return repeat(a.data_String, b.toInt().data_Int);
         fixType2(a, b);
         if(a.getType() == Int) return DataType(a.data_Int * b.data_Int);
         if(a.getType() == Float) return DataType(a.data_Float * b.data_Float);
@@ -376,81 +465,103 @@ public:
     bool operator ! () const {
         return !toBool().data_Bool;
     }
-    friend DataType operator += (DataType &a, const DataType &b) {
+    friend DataType& operator += (DataType &a, const DataType &b) { // a string grows in place, amortized linear
+        if(a.tpe == String && b.tpe == String) return a.data_String += b.data_String, a;
         return a = a + b;
     }
-    friend DataType operator -= (DataType &a, const DataType &b) {
+    friend DataType& operator -= (DataType &a, const DataType &b) {
         return a = a - b;
     }
-    friend DataType operator *= (DataType &a, const DataType &b) {
+    friend DataType& operator *= (DataType &a, const DataType &b) {
         return a = a * b;
     }
-    friend DataType operator /= (DataType &a, const DataType &b) {
+    friend DataType& operator /= (DataType &a, const DataType &b) {
         return a = a / b;
     }
-    friend DataType dualDivEqual (DataType &a, const DataType &b) {
+    friend DataType& dualDivEqual (DataType &a, const DataType &b) {
         return a = dualDiv(a, b);
     }
-    friend DataType operator %= (DataType &a, const DataType &b) {
+    friend DataType& operator %= (DataType &a, const DataType &b) {
         return a = a % b;
     }
 };
 
-template <typename T>
-class memPool {
-private:
-    set<T*> dat;
-public:
-    inline void push(T* x) {
-        dat.insert(x);
-    }
-    ~memPool() {
-        for(auto t: dat) delete t;
-    }
-};
-
-memPool<DataType> VariableDataPool;
-
+// A Variable is a handle on a cell that every frame seeing the variable shares (a call starts from a copy of
+// the globals); the cell is freed with the last handle on it.
 class Variable {
 private:
-    DataType* dst;
+    struct Cell {
+        DataType value;
+        unsigned refs;
+        static void* operator new(size_t n) {
+            return slabAllocator.allocate(n);
+        }
+        static void operator delete(void *p, size_t n) {
+            slabAllocator.deallocate(p, n);
+        }
+    };
+    Cell* dst;
+    inline void release() {
+        if(dst && !--dst->refs) delete dst;
+    }
 public:
     Variable() {
         dst = nullptr;
     }
+    Variable(const Variable &x): dst(x.dst) {
+        if(dst) ++dst->refs;
+    }
+    ~Variable() {
+        release();
+    }
+    Variable& operator = (const Variable &x) {
+        if(x.dst) ++x.dst->refs;
+        release(), dst = x.dst;
+        return *this;
+    }
     inline DataType& getContent() const {
-        return *dst;
+        return dst->value;
+    }
+    inline bool isAssigned() const {
+        return dst;
     }
-    Variable operator = (const DataType &x) { // otherwise universal variables will not be modified.
-        if(!dst) {
-            dst = new DataType(x);
-            VariableDataPool.push(dst);
-        } else *dst = x;
+    Variable& operator = (const DataType &x) { // otherwise universal variables will not be modified.
+        if(!dst) dst = new Cell{x, 1};
+        else dst->value = x;
         return *this;
     }
 };
 
+// A function's variables by symbol id; its nodes come from slabAllocator.
+typedef map<int, Variable, less<int>, SlabStlAllocator<pair<const int, Variable> > > Frame;
+
+// Frames are made as calls first get that deep and kept when popped, emptied of their cells, so that a later
+// call at the same depth assigns over the old frame's nodes. A deque does not move them when it grows.
 class VariableStack {
 private:
-    static constexpr int maxDep = 2e4 + 1e2;
-    map<string, Variable> stk[maxDep];
+    deque<Frame> stk;
+    Frame *cur;
     int top;
 public:
-    VariableStack() {
-        top = 0;
+    VariableStack(): stk(1) {
+        top = 0, cur = &stk[0];
     }
-    inline void pop() {
-        --top;
+    inline void pop() { // drops the frame's cells, keeping its nodes for the next call
+        for(auto &t: *cur) t.second = Variable();
+        cur = &stk[--top];
     }
     inline void push(bool type) { // type = 0 then build from 0, else build from top
-        if(type) ++top, stk[top] = stk[top - 1];
-        else stk[++top] = stk[0];
+        if(++top == (int) stk.size()) stk.emplace_back();
+        stk[top] = stk[type ? top - 1 : 0], cur = &stk[top];
+    }
+    inline void merge(const Frame &args) {
+        for(auto t: args) (*cur)[t.first] = t.second;
     }
-    inline void merge(const map<string, Variable> &args) {
-        for(auto t: args) stk[top][t.first] = t.second;
+    Variable& operator [] (int id) {
+        return (*cur)[id];
     }
     Variable& operator [] (const string &nme) {
-        return stk[top][nme];
+        return (*cur)[symbols.intern(nme)];
     }
 };
 
@@ -458,27 +569,23 @@ enum Statement{Running, Continued, Broken, Returned};
 
 class FlowStack {
 private:
-    static constexpr int maxDep = 2e4 + 1e2;
-    Statement stk[maxDep];
-    int top;
+    vector<Statement> stk;
 public:
-    FlowStack() {
-        memset(this, 0, sizeof *this);
-    }
+    FlowStack(): stk(1, Running) {}
     inline void push(Statement x) {
-        stk[++top] = x;
+        stk.push_back(x);
     }
     inline Statement query() {
-        return stk[top];
+        return stk.back();
     }
     inline void set(Statement x) {
-        stk[top] = x;
+        stk.back() = x;
     }
     inline void reset() {
-        stk[top] = Running;
+        stk.back() = Running;
     }
     inline void pop() {
-        --top;
+        stk.pop_back();
     }
 };
 
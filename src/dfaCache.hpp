@@ -0,0 +1,320 @@
+#ifndef PYTHON_INTERPRETER_DFACACHE_HPP
+#define PYTHON_INTERPRETER_DFACACHE_HPP
+
+#include "antlr4-runtime.h"
+#include "atn/ATNSerializer.h"
+#include "atn/ArrayPredictionContext.h"
+#include "atn/LexerATNConfig.h"
+#include "atn/OrderedATNConfigSet.h"
+#include "cacheFile.hpp"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std;
+
+// --dfa-cache: the DFA states ANTLR's prediction has built (the parser's, the lexer's) and the prediction contexts
+// they refer to, saved after a run and loaded into the still-empty DFAs of the next one. Each recognizer's part is
+// stored with a checksum of its serialized ATN, so a cache written for another grammar is ignored. DFAs that
+// depend on predicates or precedence are not saved; neither grammar has any.
+class DfaCache {
+private:
+    static constexpr uint32_t none = 0xFFFFFFFF;
+    static constexpr uint64_t magic = 0x0100004146445950ULL; // "PYDFA", format 1
+
+    struct Section {
+        uint64_t checksum;
+        const antlr4::atn::ATN *atn;
+        vector<antlr4::dfa::DFA> *dfas;
+        antlr4::atn::PredictionContextCache *contexts;
+        bool lexer;
+        size_t loadedStates;
+        string saved; // as read from the file, written back unchanged if the recognizer was never attached
+    };
+
+    string path;
+    vector<Section> sections;
+    bool readFile;
+
+    static uint64_t checksum(const antlr4::atn::ATN &atn) {
+        uint64_t h = 14695981039346656037ULL;
+        for(size_t x: antlr4::atn::ATNSerializer::getSerialized(const_cast<antlr4::atn::ATN*>(&atn)))
+            h = (h ^ x) * 1099511628211ULL;
+        return h;
+    }
+    static size_t stateCount(const vector<antlr4::dfa::DFA> &dfas) {
+        size_t ret = 0;
+        for(auto &dfa: dfas) ret += dfa.states.size();
+        return ret;
+    }
+
+    // ids: 0 null, 1 EMPTY, then parents before children.
+    static uint32_t contextId(const Ref<antlr4::atn::PredictionContext> &ctx, map<antlr4::atn::PredictionContext*, uint32_t> &ids,
+                              vector<Ref<antlr4::atn::PredictionContext> > &order) {
+        if(!ctx) return 0;
+        if(ctx == antlr4::atn::PredictionContext::EMPTY) return 1;
+        auto it = ids.find(ctx.get());
+        if(it != ids.end()) return it->second;
+        for(size_t i = 0; i < ctx->size(); i++) contextId(ctx->getParent(i), ids, order);
+        order.push_back(ctx);
+        return ids[ctx.get()] = order.size() + 1;
+    }
+
+    static bool writeExecutor(CacheWriter &w, const Ref<antlr4::atn::LexerActionExecutor> &exec, const antlr4::atn::ATN &atn) {
+        if(!exec) return w.u32(none), 1;
+        const auto actions = exec->getLexerActions();
+        w.u32(actions.size());
+        for(auto action: actions) {
+            uint32_t offset = none;
+            if(auto indexed = dynamic_pointer_cast<antlr4::atn::LexerIndexedCustomAction>(action))
+                offset = indexed->getOffset(), action = indexed->getAction();
+            size_t index = 0;
+            while(index < atn.lexerActions.size() && *atn.lexerActions[index] != *action) index++;
+            if(index == atn.lexerActions.size()) return 0;
+            w.u32(offset), w.u32(index);
+        }
+        return 1;
+    }
+    static Ref<antlr4::atn::LexerActionExecutor> readExecutor(CacheReader &r, const antlr4::atn::ATN &atn) {
+        const uint32_t n = r.u32();
+        if(n == none || !r.ok) return nullptr;
+        vector<Ref<antlr4::atn::LexerAction> > actions;
+        for(uint32_t i = 0; i < n && r.ok; i++) {
+            const uint32_t offset = r.u32(), index = r.u32();
+            if(index >= atn.lexerActions.size()) return r.ok = 0, nullptr;
+            auto action = atn.lexerActions[index];
+            if(offset != none) action = make_shared<antlr4::atn::LexerIndexedCustomAction>(offset, action);
+            actions.push_back(action);
+        }
+        return make_shared<antlr4::atn::LexerActionExecutor>(actions);
+    }
+
+    // "" if some DFA uses what the format leaves out.
+    static string serialize(const Section &s) {
+        CacheWriter w;
+        map<antlr4::atn::PredictionContext*, uint32_t> ids;
+        vector<Ref<antlr4::atn::PredictionContext> > order;
+        for(auto &ctx: *s.contexts) contextId(ctx, ids, order);
+        for(auto &dfa: *s.dfas) {
+            if(dfa.isPrecedenceDfa()) return "";
+            for(auto state: dfa.states) {
+                if(!state->predicates.empty()) return "";
+                for(auto &c: state->configs->configs) {
+                    if(c->semanticContext != antlr4::atn::SemanticContext::NONE) return "";
+                    contextId(c->context, ids, order);
+                }
+            }
+        }
+        w.u32(order.size());
+        for(auto &ctx: order) {
+            w.u8(dynamic_cast<antlr4::atn::ArrayPredictionContext*>(ctx.get()) ? 2 : 1), w.u32(ctx->size());
+            for(size_t i = 0; i < ctx->size(); i++) w.u32(contextId(ctx->getParent(i), ids, order)), w.u64(ctx->getReturnState(i));
+        }
+        w.u32(s.dfas->size());
+        for(auto &dfa: *s.dfas) {
+            vector<antlr4::dfa::DFAState*> states(dfa.states.begin(), dfa.states.end());
+            map<antlr4::dfa::DFAState*, uint32_t> index;
+            for(auto state: states) {
+                const uint32_t k = index.size();
+                index[state] = k;
+            }
+            w.u32(states.size());
+            for(auto state: states) {
+                auto configs = state->configs.get();
+                w.u32(state->stateNumber);
+                w.u8(state->isAcceptState | state->requiresFullContext << 1 | configs->fullCtx << 2);
+                w.u64(state->prediction), w.u64(configs->uniqueAlt);
+                w.u32(configs->conflictingAlts.count());
+                for(size_t i = 0; i < configs->conflictingAlts.size(); i++) if(configs->conflictingAlts.test(i)) w.u32(i);
+                if(!writeExecutor(w, state->lexerActionExecutor, *s.atn)) return "";
+                w.u32(configs->configs.size());
+                for(auto &c: configs->configs) {
+                    w.u32(c->state->stateNumber), w.u32(c->alt), w.u32(contextId(c->context, ids, order));
+                    w.u64(c->reachesIntoOuterContext);
+                    if(!s.lexer) continue;
+                    auto lc = static_pointer_cast<antlr4::atn::LexerATNConfig>(c);
+                    w.u8(lc->hasPassedThroughNonGreedyDecision());
+                    if(!writeExecutor(w, lc->getLexerActionExecutor(), *s.atn)) return "";
+                }
+                w.u32(state->edges.size());
+                for(auto &edge: state->edges) {
+                    const bool error = edge.second == antlr4::atn::ATNSimulator::ERROR.get();
+                    if(!error && !index.count(edge.second)) return "";
+                    w.u64(edge.first), w.u32(error ? none : index[edge.second]);
+                }
+            }
+            w.u32(dfa.s0 && index.count(dfa.s0) ? index[dfa.s0] : none);
+        }
+        return w.out;
+    }
+
+    static Ref<antlr4::atn::LexerATNConfig> lexerConfig(antlr4::atn::ATNState *state, size_t alt, const Ref<antlr4::atn::PredictionContext> &ctx,
+                                                       const Ref<antlr4::atn::LexerActionExecutor> &exec, bool nonGreedy,
+                                                       antlr4::atn::ATNState *nonGreedyState) {
+        auto ret = make_shared<antlr4::atn::LexerATNConfig>(state, alt, ctx, exec);
+        if(!nonGreedy) return ret;
+        // the flag is only ever inherited: pass a copy through a non-greedy decision state first.
+        auto through = make_shared<antlr4::atn::LexerATNConfig>(ret, nonGreedyState);
+        return make_shared<antlr4::atn::LexerATNConfig>(through, state, ctx);
+    }
+
+    // fills the section's DFAs, which must be empty; nothing changes unless all of data is valid.
+    static bool deserialize(const Section &s, const string &data) {
+        CacheReader r(data);
+        const auto &atn = *s.atn;
+        antlr4::atn::ATNState *nonGreedyState = nullptr;
+        for(auto state: atn.states) {
+            auto decision = dynamic_cast<antlr4::atn::DecisionState*>(state);
+            if(decision && decision->nonGreedy) nonGreedyState = decision;
+        }
+        vector<Ref<antlr4::atn::PredictionContext> > contexts = {nullptr, antlr4::atn::PredictionContext::EMPTY};
+        for(uint32_t n = r.u32(); n-- && r.ok; ) {
+            const uint8_t kind = r.u8();
+            const uint32_t size = r.u32();
+            if(!r.ok || !size || size > data.size() || (kind == 1 && size != 1) || kind < 1 || kind > 2) return 0;
+            vector<Ref<antlr4::atn::PredictionContext> > parents;
+            vector<size_t> returnStates;
+            for(uint32_t i = 0; i < size; i++) {
+                const uint32_t parent = r.u32();
+                if(parent >= contexts.size()) return 0;
+                parents.push_back(contexts[parent]), returnStates.push_back(r.u64());
+            }
+            Ref<antlr4::atn::PredictionContext> ctx;
+            if(kind == 1) ctx = antlr4::atn::SingletonPredictionContext::create(parents[0], returnStates[0]);
+            else ctx = make_shared<antlr4::atn::ArrayPredictionContext>(parents, returnStates);
+            contexts.push_back(ctx);
+        }
+        if(!r.ok || r.u32() != s.dfas->size()) return 0;
+        typedef vector<unique_ptr<antlr4::dfa::DFAState> > States;
+        vector<States> built(s.dfas->size());
+        vector<antlr4::dfa::DFAState*> starts(s.dfas->size());
+        vector<vector<vector<pair<uint64_t, uint32_t> > > > edges(s.dfas->size());
+        for(size_t d = 0; d < s.dfas->size() && r.ok; d++) {
+            const uint32_t n = r.u32();
+            if(!r.ok || n > data.size()) return 0;
+            edges[d].resize(n);
+            for(uint32_t k = 0; k < n && r.ok; k++) {
+                const int number = r.u32();
+                const uint8_t flags = r.u8();
+                const uint64_t prediction = r.u64(), uniqueAlt = r.u64();
+                unique_ptr<antlr4::atn::ATNConfigSet> configs(s.lexer ? new antlr4::atn::OrderedATNConfigSet() : new antlr4::atn::ATNConfigSet(flags >> 2 & 1));
+                for(uint32_t m = r.u32(); m-- && r.ok; ) {
+                    const uint32_t alt = r.u32();
+                    if(alt >= configs->conflictingAlts.size()) return 0;
+                    configs->conflictingAlts.set(alt);
+                }
+                auto exec = readExecutor(r, atn);
+                for(uint32_t m = r.u32(); m-- && r.ok; ) {
+                    const uint32_t state = r.u32(), alt = r.u32(), ctx = r.u32();
+                    const uint64_t reaches = r.u64();
+                    if(!r.ok || state >= atn.states.size() || ctx >= contexts.size()) return 0;
+                    Ref<antlr4::atn::ATNConfig> c;
+                    if(s.lexer) {
+                        const bool nonGreedy = r.u8();
+                        auto configExec = readExecutor(r, atn);
+                        if(nonGreedy && !nonGreedyState) return 0;
+                        c = lexerConfig(atn.states[state], alt, contexts[ctx], configExec, nonGreedy, nonGreedyState);
+                    }
+                    else c = make_shared<antlr4::atn::ATNConfig>(atn.states[state], alt, contexts[ctx]);
+                    c->reachesIntoOuterContext = reaches;
+                    configs->add(c);
+                }
+                configs->uniqueAlt = uniqueAlt;
+                configs->setReadonly(true);
+                unique_ptr<antlr4::dfa::DFAState> state(new antlr4::dfa::DFAState(move(configs)));
+                state->stateNumber = number, state->isAcceptState = flags & 1, state->requiresFullContext = flags >> 1 & 1;
+                state->prediction = prediction, state->lexerActionExecutor = exec;
+                for(uint32_t m = r.u32(); m-- && r.ok; ) {
+                    const uint64_t key = r.u64();
+                    const uint32_t target = r.u32();
+                    if(target != none && target >= n) return 0;
+                    edges[d][k].push_back(make_pair(key, target));
+                }
+                built[d].push_back(move(state));
+            }
+            const uint32_t start = r.u32();
+            if(start != none && start >= n) return 0;
+            starts[d] = start == none ? nullptr : built[d][start].get();
+        }
+        if(!r.ok || !r.done()) return 0;
+        for(size_t d = 0; d < s.dfas->size(); d++) {
+            auto &dfa = (*s.dfas)[d];
+            for(size_t k = 0; k < built[d].size(); k++)
+                for(auto &edge: edges[d][k])
+                    built[d][k]->edges[edge.first] = edge.second == none ? antlr4::atn::ATNSimulator::ERROR.get() : built[d][edge.second].get();
+            for(auto &state: built[d]) dfa.states.insert(state.release());
+            dfa.s0 = starts[d];
+        }
+        for(size_t i = 2; i < contexts.size(); i++) s.contexts->insert(contexts[i]);
+        return 1;
+    }
+
+public:
+    explicit DfaCache(const string &_path): path(_path), readFile(0) {}
+    DfaCache(const DfaCache&) = delete;
+    DfaCache& operator = (const DfaCache&) = delete;
+    // the recognizers' DFAs are static, so they are still there when a cache in main goes out of scope.
+    ~DfaCache() {
+        if(!save()) cerr << "cannot write DFA cache " << path << ": " << strerror(errno) << endl;
+    }
+
+    // loads recognizer's part of the cache into its DFAs the first time a recognizer with its ATN is attached,
+    // and remembers them for save.
+    template<class Simulator> void attach(antlr4::Recognizer &recognizer, vector<antlr4::dfa::DFA> &dfas, bool lexer) {
+        auto simulator = recognizer.getInterpreter<Simulator>();
+        const auto &atn = recognizer.getATN();
+        if(!readFile) read();
+        for(auto &s: sections) if(s.atn == &atn) return;
+        const uint64_t sum = checksum(atn);
+        Section *s = nullptr;
+        for(auto &t: sections) if(!t.atn && t.checksum == sum) s = &t;
+        if(!s) sections.push_back(Section()), s = &sections.back(), s->checksum = sum;
+        s->atn = &atn, s->dfas = &dfas, s->contexts = &simulator->getSharedContextCache(), s->lexer = lexer;
+        if(!s->saved.empty() && !stateCount(dfas) && !deserialize(*s, s->saved)) s->saved.clear();
+        s->loadedStates = stateCount(dfas);
+    }
+    void attach(antlr4::Parser &parser) {
+        attach<antlr4::atn::ParserATNSimulator>(parser, parser.getInterpreter<antlr4::atn::ParserATNSimulator>()->decisionToDFA, 0);
+    }
+    void attach(antlr4::Lexer &lexer) {
+        attach<antlr4::atn::LexerATNSimulator>(lexer, lexer.getInterpreter<antlr4::atn::LexerATNSimulator>()->_decisionToDFA, 1);
+    }
+
+    void read() {
+        readFile = 1;
+        string data;
+        if(!readCacheFile(path, data)) return;
+        CacheReader r(data);
+        if(r.u64() != magic) return;
+        vector<Section> found;
+        for(uint32_t n = r.u32(); n-- && r.ok; ) {
+            Section s = Section();
+            s.checksum = r.u64();
+            s.saved = r.str();
+            found.push_back(move(s));
+        }
+        if(r.ok && r.done()) sections = move(found);
+    }
+
+    // writes the cache if an attached DFA grew since it was loaded; a new file replaces the old one atomically.
+    bool save() {
+        bool grew = 0;
+        for(auto &s: sections) if(s.atn && stateCount(*s.dfas) != s.loadedStates) grew = 1;
+        if(!grew) return 1;
+        CacheWriter w;
+        w.u64(magic);
+        vector<pair<uint64_t, string> > parts;
+        for(auto &s: sections) {
+            string body = s.atn ? serialize(s) : s.saved;
+            if(!body.empty()) parts.push_back(make_pair(s.checksum, move(body)));
+        }
+        w.u32(parts.size());
+        for(auto &part: parts) w.u64(part.first), w.str(part.second);
+        return writeCacheFile(path, w.out);
+    }
+};
+
+#endif //PYTHON_INTERPRETER_DFACACHE_HPP
@@ -0,0 +1,99 @@
+#ifndef PYTHON_INTERPRETER_DIGITPOOL_HPP
+#define PYTHON_INTERPRETER_DIGITPOOL_HPP
+
+#include <cstring>
+#include <new>
+#include <ostream>
+using namespace std;
+
+// Allocator for BigInt digit buffers, which every arithmetic operation makes and drops, mostly in a few sizes.
+// Requests are rounded up to a power of two from 16 bytes; each size class keeps the blocks freed to it on a
+// freelist and hands them out first, holding on to at most cachedBytes of them (or one block, if that is bigger).
+// The rest goes back to the heap, as do requests past the largest class. Not thread-safe.
+class DigitPool {
+public:
+    static constexpr size_t minBytes = 16, classes = 20, cachedBytes = 1 << 20;
+
+private:
+    struct Block {
+        Block *next;
+    };
+    struct SizeClass {
+        Block *free;
+        size_t cached, allocations, reused;
+    };
+    SizeClass sizes[classes];
+    size_t largeAllocations;
+
+    static size_t classOf(size_t n) { // the smallest k with n <= minBytes << k
+        return n <= minBytes ? 0 : 64 - __builtin_clzll(n - 1) - __builtin_ctzll(minBytes);
+    }
+
+public:
+    DigitPool(): largeAllocations(0) {
+        memset(sizes, 0, sizeof sizes);
+    }
+    DigitPool(const DigitPool&) = delete;
+    DigitPool& operator = (const DigitPool&) = delete;
+    ~DigitPool() {
+        for(auto &c: sizes) while(c.free) {
+            Block *b = c.free;
+            c.free = b->next, ::operator delete(b);
+        }
+    }
+
+    void* allocate(size_t n) {
+        const size_t k = classOf(n);
+        if(k >= classes) return largeAllocations++, ::operator new(n);
+        SizeClass &c = sizes[k];
+        c.allocations++;
+        if(!c.free) return ::operator new(minBytes << k);
+        Block *ret = c.free;
+        c.free = ret->next, c.cached -= minBytes << k, c.reused++;
+        return ret;
+    }
+    void deallocate(void *p, size_t n) {
+        const size_t k = classOf(n);
+        if(k >= classes) return ::operator delete(p);
+        SizeClass &c = sizes[k];
+        if(c.free && c.cached + (minBytes << k) > cachedBytes) return ::operator delete(p);
+        Block *b = (Block*) p;
+        b->next = c.free, c.free = b, c.cached += minBytes << k;
+    }
+
+    // for --alloc-stats: the counters of every size class used so far.
+    void report(ostream &os) const {
+        for(size_t k = 0; k < classes; k++) {
+            const SizeClass &c = sizes[k];
+            if(!c.allocations) continue;
+            os << "digits " << (minBytes << k) << " bytes: " << c.allocations << " allocations, " << c.reused << " reused, "
+               << c.cached << " bytes cached" << endl;
+        }
+        if(largeAllocations) os << "digits, large: " << largeAllocations << " allocations" << endl;
+    }
+};
+
+// Defined ahead of every global holding a BigInt, so it is destroyed after them.
+DigitPool digitPool;
+
+template<class T>
+class DigitAllocator {
+public:
+    typedef T value_type;
+    DigitAllocator() {}
+    template<class U> DigitAllocator(const DigitAllocator<U>&) {}
+    T* allocate(size_t n) {
+        return (T*) digitPool.allocate(n * sizeof(T));
+    }
+    void deallocate(T *p, size_t n) {
+        digitPool.deallocate(p, n * sizeof(T));
+    }
+    template<class U> bool operator == (const DigitAllocator<U>&) const {
+        return 1;
+    }
+    template<class U> bool operator != (const DigitAllocator<U>&) const {
+        return 0;
+    }
+};
+
+#endif //PYTHON_INTERPRETER_DIGITPOOL_HPP
@@ -0,0 +1,40 @@
+#ifndef PYTHON_INTERPRETER_FLOATFORMAT_HPP
+#define PYTHON_INTERPRETER_FLOATFORMAT_HPP
+
+#include <cstdio>
+#include <cstring>
+
+// Floats print as "%0.6f". This writes the same text into out (at least fixedBufferSize bytes) and returns
+// its length, without going through printf: the double is scaled by 10^6 exactly in 128-bit integers and
+// rounded half to even, as glibc rounds. Values from 2^60 up and inf/nan are left to snprintf.
+static constexpr int fixedBufferSize = 400;
+
+inline int formatFixed6(const double &x, char *out) {
+    unsigned long long bits;
+    memcpy(&bits, &x, sizeof bits); // bit tests: isnan and signbit are not reliable under -Ofast
+    const int biased = bits >> 52 & 0x7FF;
+    if(biased >= 1023 + 60) return snprintf(out, fixedBufferSize, "%0.6f", x);
+    unsigned long long mant = bits & ((1ull << 52) - 1);
+    int shift = 1074; // x = mant / 2^shift
+    if(biased) mant |= 1ull << 52, shift = 1075 - biased;
+    unsigned __int128 q;
+    if(shift <= 0) q = ((unsigned __int128) mant << -shift) * 1000000;
+    else if(shift >= 100) q = 0; // below 2^-26: scaled is < 2^73, far under half a unit
+    else {
+        const unsigned __int128 scaled = (unsigned __int128) mant * 1000000, half = (unsigned __int128) 1 << (shift - 1);
+        const unsigned __int128 rem = scaled & ((half << 1) - 1);
+        q = scaled >> shift;
+        if(rem > half || (rem == half && (q & 1))) ++q;
+    }
+    unsigned long long intPart = q / 1000000, frac = q % 1000000;
+    char digits[24];
+    int n = 0, len = 0;
+    do digits[n++] = '0' + intPart % 10, intPart /= 10; while(intPart);
+    if(bits >> 63) out[len++] = '-';
+    while(n) out[len++] = digits[--n];
+    out[len++] = '.';
+    for(int i = 5; i >= 0; i--) out[len + i] = '0' + frac % 10, frac /= 10;
+    return len + 6;
+}
+
+#endif //PYTHON_INTERPRETER_FLOATFORMAT_HPP
@@ -0,0 +1,111 @@
+#ifndef PYTHON_INTERPRETER_FRAMEARENA_HPP
+#define PYTHON_INTERPRETER_FRAMEARENA_HPP
+
+#include <new>
+#include <ostream>
+#include <vector>
+using namespace std;
+
+// Bump-pointer arena for the evaluator's scratch storage: the child lists and value buffers a visit builds and
+// drops before it returns. A Scope marks where the arena is and rolls it back there when it ends; the evaluator
+// opens one per statement, per loop iteration and per function call, so a frame's scratch is released in one step
+// when the call returns. Values never live here, they outlive the frame that computed them.
+// Chunks are kept for reuse once allocated; requests bigger than a quarter chunk go to the heap. Not thread-safe.
+class FrameArena {
+public:
+    static constexpr size_t alignment = 16, chunkBytes = 64 << 10;
+    struct Mark {
+        size_t used;
+        char *at;
+    };
+
+private:
+    vector<char*> chunks;
+    size_t used; // chunks[used - 1] is the one being carved
+    char *at, *end;
+    size_t allocations, bytes, largeAllocations, largeBytes, peak;
+
+    static size_t round(size_t n) {
+        return (n + alignment - 1) / alignment * alignment;
+    }
+
+public:
+    FrameArena(): used(0), at(nullptr), end(nullptr), allocations(0), bytes(0), largeAllocations(0), largeBytes(0), peak(0) {}
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator = (const FrameArena&) = delete;
+    ~FrameArena() {
+        for(auto c: chunks) ::operator delete(c);
+    }
+
+    void* allocate(size_t n) {
+        n = round(n ? n : 1);
+        if(n > chunkBytes / 4) return largeAllocations++, largeBytes += n, ::operator new(n);
+        allocations++, bytes += n;
+        if((size_t) (end - at) < n) {
+            if(used == chunks.size()) chunks.push_back((char*) ::operator new(chunkBytes));
+            at = chunks[used++], end = at + chunkBytes;
+            if(used > peak) peak = used;
+        }
+        void *ret = at;
+        at += n;
+        return ret;
+    }
+    // only the latest block goes back right away, which is what a growing vector frees; the rest waits for its Scope.
+    void deallocate(void *p, size_t n) {
+        n = round(n ? n : 1);
+        if(n > chunkBytes / 4) return ::operator delete(p);
+        if((char*) p + n == at) at = (char*) p;
+    }
+
+    Mark mark() const {
+        return Mark{used, at};
+    }
+    void release(const Mark &m) {
+        used = m.used, at = m.at, end = used ? chunks[used - 1] + chunkBytes : nullptr;
+    }
+
+    class Scope {
+    private:
+        FrameArena &arena;
+        const Mark start;
+    public:
+        explicit Scope(FrameArena &_arena): arena(_arena), start(_arena.mark()) {}
+        Scope(const Scope&) = delete;
+        ~Scope() {
+            arena.release(start);
+        }
+    };
+
+    // for --alloc-stats, next to what the heap served in the same run (see heapCounter.hpp).
+    void report(ostream &os) const {
+        os << "arena: " << allocations << " allocations, " << bytes << " bytes, at most " << peak << " chunks of " << (chunkBytes >> 10) << " KiB in use" << endl;
+        if(largeAllocations) os << "arena, sent to the heap: " << largeAllocations << " allocations, " << largeBytes << " bytes" << endl;
+    }
+};
+
+FrameArena frameArena;
+
+// An STL allocator on frameArena, for containers that die inside the Scope they were built in.
+template<class T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+    ArenaAllocator() {}
+    template<class U> ArenaAllocator(const ArenaAllocator<U>&) {}
+    T* allocate(size_t n) {
+        return (T*) frameArena.allocate(n * sizeof(T));
+    }
+    void deallocate(T *p, size_t n) {
+        frameArena.deallocate(p, n * sizeof(T));
+    }
+    template<class U> bool operator == (const ArenaAllocator<U>&) const {
+        return 1;
+    }
+    template<class U> bool operator != (const ArenaAllocator<U>&) const {
+        return 0;
+    }
+};
+
+template<class T> using ArenaVector = vector<T, ArenaAllocator<T> >;
+
+#endif //PYTHON_INTERPRETER_FRAMEARENA_HPP
@@ -0,0 +1,52 @@
+#ifndef PYTHON_INTERPRETER_HEAPCOUNTER_HPP
+#define PYTHON_INTERPRETER_HEAPCOUNTER_HPP
+
+#include <cstdlib>
+#include <new>
+#include <ostream>
+#include <sys/resource.h>
+using namespace std;
+
+// --alloc-stats: the heap's side of the count. It replaces the global operator new and delete, so it must be
+// included by the one file of a program that owns main() and by no header. It counts every operator new and
+// new[] of the process, slab and arena chunks included. bench/mallocCount.cpp counts malloc instead, by
+// preloading, which works on any build. The replacements are kept out of line: inlined, delete would show the
+// compiler a free() of what new returned.
+struct HeapCounter {
+    size_t allocations, bytes;
+
+    // with the most memory the process held.
+    void report(ostream &os) const {
+        os << "heap: " << allocations << " allocations, " << bytes << " bytes" << endl;
+        rusage usage;
+        if(!getrusage(RUSAGE_SELF, &usage)) os << "peak RSS: " << usage.ru_maxrss << " KiB" << endl;
+    }
+};
+HeapCounter heapCounter;
+
+__attribute__((noinline)) void* operator new(size_t n) {
+    heapCounter.allocations++, heapCounter.bytes += n;
+    while(1) { // as the standard one: the new_handler may free memory and have it retried
+        if(void *ret = malloc(n ? n : 1)) return ret;
+        const new_handler handler = get_new_handler();
+        if(!handler) throw bad_alloc();
+        handler();
+    }
+}
+__attribute__((noinline)) void* operator new[](size_t n) {
+    return ::operator new(n);
+}
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    free(p);
+}
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept {
+    ::operator delete(p);
+}
+__attribute__((noinline)) void operator delete[](void *p) noexcept {
+    ::operator delete(p);
+}
+__attribute__((noinline)) void operator delete[](void *p, size_t) noexcept {
+    ::operator delete(p);
+}
+
+#endif //PYTHON_INTERPRETER_HEAPCOUNTER_HPP
@@ -0,0 +1,613 @@
+#ifndef PYTHON_INTERPRETER_JIT_HPP
+#define PYTHON_INTERPRETER_JIT_HPP
+
+#include "syntheticNodes.hpp"
+#include "treeUtils.hpp"
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#define PYTHON_INTERPRETER_JIT_NATIVE 1
+#endif
+
+// Template JIT for hot while loops and function bodies (--jit).
+// A region compiles when every name it touches holds an Int that fits in 64 bits or a Float, keeps that type,
+// and the code only does arithmetic, comparisons, if/while/break/continue and (in functions) return.
+// Each name lives in a slot; operators are emitted one template each, with guards that bail out to the
+// interpreter on int64 overflow, division by zero, or an Int too large to convert to Float exactly.
+// Regions have no side effects besides their slots, so bailing is exact: a loop restores the slots saved at
+// the start of the current iteration and the interpreter redoes it, a function is interpreted from the start.
+
+enum JitType {JitUnknown, JitInt, JitFloat, JitBool, JitBad};
+enum JitExit {JitNone, JitReturnInt, JitReturnFloat, JitBail, JitDeclined}; // the first four come from native code
+
+#ifdef PYTHON_INTERPRETER_JIT_NATIVE
+
+class X64Assembler {
+private:
+    vector<int> labels;
+    vector<pair<int, int> > fixups; // (offset of rel32, label)
+
+    void rex(int reg, int rm) {
+        byte(0x48 | (reg >= 8) << 2 | (rm >= 8));
+    }
+    void modrm(int reg, int rm) {
+        byte(0xC0 | (reg & 7) << 3 | (rm & 7));
+    }
+    void op(int opcode, int reg, int rm) { // opcode r/m64, r64
+        rex(reg, rm), byte(opcode), modrm(reg, rm);
+    }
+    void memory(int opcode, int reg, int base, int slot) { // opcode with [base + 8 * slot]
+        rex(reg, base), byte(opcode), byte(0x80 | (reg & 7) << 3 | (base & 7)), imm32(8 * slot);
+    }
+    void rel32(int label) {
+        fixups.push_back(make_pair((int) code.size(), label)), imm32(0);
+    }
+
+public:
+    enum Reg {RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9};
+    enum Cond {O = 0, B = 2, AE = 3, E = 4, NE = 5, BE = 6, A = 7, S = 8, NS = 9, P = 10, NP = 11, L = 12, GE = 13, LE = 14, G = 15};
+    vector<uint8_t> code;
+
+    void clear() {
+        code.clear(), labels.clear(), fixups.clear();
+    }
+    void byte(int x) {
+        code.push_back(x);
+    }
+    void imm32(int32_t x) {
+        for(int i = 0; i < 4; i++) byte(x >> (8 * i) & 0xFF);
+    }
+    void imm64(int64_t x) {
+        for(int i = 0; i < 8; i++) byte(x >> (8 * i) & 0xFF);
+    }
+
+    void mov(Reg dst, Reg src) {op(0x89, src, dst);}
+    void add(Reg dst, Reg src) {op(0x01, src, dst);}
+    void sub(Reg dst, Reg src) {op(0x29, src, dst);}
+    void cmp(Reg a, Reg b) {op(0x39, b, a);}
+    void test(Reg a, Reg b) {op(0x85, b, a);}
+    void xorr(Reg dst, Reg src) {op(0x31, src, dst);}
+    void imul(Reg dst, Reg src) {
+        rex(dst, src), byte(0x0F), byte(0xAF), modrm(dst, src);
+    }
+    void movImm(Reg dst, int64_t x) {
+        rex(0, dst), byte(0xB8 + (dst & 7)), imm64(x);
+    }
+    void movEax(int32_t x) {
+        byte(0xB8), imm32(x);
+    }
+    void immOp(int ext, Reg dst, int8_t x) { // add (0), xor (6), cmp (7) r/m64, imm8
+        rex(0, dst), byte(0x83), modrm(ext, dst), byte(x);
+    }
+    void load(Reg dst, Reg base, int slot) {memory(0x8B, dst, base, slot);}
+    void store(Reg base, int slot, Reg src) {memory(0x89, src, base, slot);}
+    void push(Reg r) {byte(0x50 + r);}
+    void pop(Reg r) {byte(0x58 + r);}
+    void neg(Reg r) {rex(0, r), byte(0xF7), modrm(3, r);}
+    void shl1(Reg r) {rex(0, r), byte(0xD1), modrm(4, r);}
+    void cqo() {byte(0x48), byte(0x99);}
+    void idiv(Reg r) {rex(0, r), byte(0xF7), modrm(7, r);}
+    void setcc(Cond cc, Reg r8) {byte(0x0F), byte(0x90 | cc), modrm(0, r8);} // al, cl, dl, bl only
+    void movzx8(Reg r) {byte(0x0F), byte(0xB6), modrm(r, r);}
+    void and8(Reg dst, Reg src) {byte(0x20), modrm(src, dst);}
+    void or8(Reg dst, Reg src) {byte(0x08), modrm(src, dst);}
+    void toXmm(int x, Reg r) {byte(0x66), rex(x, r), byte(0x0F), byte(0x6E), modrm(x, r);}
+    void fromXmm(Reg r, int x) {byte(0x66), rex(x, r), byte(0x0F), byte(0x7E), modrm(x, r);}
+    void cvtsi2sd(int x, Reg r) {byte(0xF2), rex(x, r), byte(0x0F), byte(0x2A), modrm(x, r);}
+    void sse(int opcode, int dst, int src) {byte(0xF2), byte(0x0F), byte(opcode), modrm(dst, src);} // addsd 58, mulsd 59, subsd 5C, divsd 5E
+    void ucomisd(int a, int b) {byte(0x66), byte(0x0F), byte(0x2E), modrm(a, b);}
+    void ret() {byte(0xC3);}
+
+    int label() {
+        labels.push_back(-1);
+        return labels.size() - 1;
+    }
+    void bind(int label) {
+        labels[label] = code.size();
+    }
+    void jcc(Cond cc, int label) {
+        byte(0x0F), byte(0x80 | cc), rel32(label);
+    }
+    void jmp(int label) {
+        byte(0xE9), rel32(label);
+    }
+    void resolve() {
+        for(auto t: fixups) {
+            const int32_t rel = labels[t.second] - (t.first + 4);
+            memcpy(&code[t.first], &rel, 4);
+        }
+    }
+};
+
+class ExecutableCode {
+private:
+    void *mem;
+    size_t size;
+public:
+    explicit ExecutableCode(const vector<uint8_t> &code): mem(nullptr), size(code.size()) {
+        void *page = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(page == MAP_FAILED) return;
+        memcpy(page, code.data(), size);
+        if(mprotect(page, size, PROT_READ | PROT_EXEC)) munmap(page, size);
+        else mem = page;
+    }
+    ExecutableCode(const ExecutableCode&) = delete;
+    ExecutableCode& operator = (const ExecutableCode&) = delete;
+    ~ExecutableCode() {
+        if(mem) munmap(mem, size);
+    }
+    void* entry() const {
+        return mem;
+    }
+};
+
+#endif
+
+// A compiled region and the frame layout it expects: slot i holds names[i], slot n + i says whether a name
+// that may be unassigned on entry has been assigned, slot 2n takes the return value.
+class JitRegion {
+public:
+    vector<string> names;
+    vector<int> ids; // their symbol ids
+    vector<JitType> types;
+    vector<bool> maybeUnassigned, written;
+    bool isFunction;
+#ifdef PYTHON_INTERPRETER_JIT_NATIVE
+    unique_ptr<ExecutableCode> code;
+#endif
+
+    JitExit run(const vector<Variable*> &cells, DataType &result) {
+#ifdef PYTHON_INTERPRETER_JIT_NATIVE
+        const unsigned n = names.size();
+        vector<int64_t> slots(2 * n + 1), checkpoint(2 * n + 1);
+        for(unsigned i = 0; i < n; i++) {
+            if(!cells[i]->isAssigned()) {
+                if(!maybeUnassigned[i]) return JitDeclined;
+                continue;
+            }
+            const DataType &x = cells[i]->getContent();
+            long long val;
+            if(types[i] == JitInt && x.tpe == Int && x.data_Int.toLongLong(val)) slots[i] = val;
+            else if(types[i] == JitFloat && x.tpe == Float) memcpy(&slots[i], &x.data_Float, 8);
+            else return JitDeclined;
+            slots[n + i] = 1;
+        }
+        const auto exit = (JitExit) reinterpret_cast<int (*)(int64_t*, int64_t*)>(code->entry())(slots.data(), checkpoint.data());
+        if(exit == JitBail) {
+            if(isFunction) return exit; // nothing was written, so the call can start over
+            slots = checkpoint;
+        }
+        for(unsigned i = 0; i < n; i++) {
+            if(!written[i] || !slots[n + i]) continue;
+            if(types[i] == JitInt) {
+                if(cells[i]->isAssigned() && cells[i]->getContent().tpe == Int) cells[i]->getContent().data_Int.fromLongLong(slots[i]);
+                else {
+                    BigInt val;
+                    val.fromLongLong(slots[i]);
+                    *cells[i] = DataType(val);
+                }
+            } else {
+                double val;
+                memcpy(&val, &slots[i], 8);
+                *cells[i] = DataType(val);
+            }
+        }
+        if(exit == JitReturnInt) result = DataType(Int), result.data_Int.fromLongLong(slots[2 * n]);
+        else if(exit == JitReturnFloat) result = DataType(0.0), memcpy(&result.data_Float, &slots[2 * n], 8);
+        else result = DataType(None);
+        return exit;
+#else
+        return JitDeclined;
+#endif
+    }
+};
+
+#ifdef PYTHON_INTERPRETER_JIT_NATIVE
+
+class JitCompiler {
+private:
+    typedef X64Assembler Asm;
+    Asm as;
+    JitRegion *region;
+    map<string, int> slotOf;
+    bool strict, changed;
+    int bail, exit;
+    vector<pair<int, int> > loops; // (head, end) labels of the enclosing whiles
+
+    // names read or assigned in the region, including inside hoisted and specialized expressions.
+    void collect(antlr4::tree::ParseTree *node, set<string> &names, set<string> &assigned) {
+        if(auto atom = dynamic_cast<Python3Parser::AtomContext*>(node)) {
+            if(isSynthetic(atom)) {
+                const auto synthetic = static_cast<SyntheticAtom*>(atom);
+                if(synthetic->kind != Constant) collect(synthetic->origin, names, assigned);
+                return;
+            }
+            if(atom->NAME()) names.insert(atom->NAME()->getText());
+        }
+        if(auto stmt = dynamic_cast<Python3Parser::Expr_stmtContext*>(node)) collectTargets(stmt, assigned);
+        if(auto arg = dynamic_cast<Python3Parser::TfpdefContext*>(node)) names.insert(arg->getText());
+        for(auto child: node->children) collect(child, names, assigned);
+    }
+
+    static int tokenOf(antlr4::tree::ParseTree *op) {
+        return static_cast<antlr4::ParserRuleContext*>(op)->getStart()->getType();
+    }
+
+    // the slot of a plain name, or -1 when test is anything else.
+    int nameSlot(Python3Parser::TestlistContext *list) {
+        if(list->test().size() != 1) return -1;
+        antlr4::tree::ParseTree *node = list->test(0);
+        while(node->children.size() == 1 && !dynamic_cast<Python3Parser::AtomContext*>(node)) node = node->children[0];
+        const auto atom = dynamic_cast<Python3Parser::AtomContext*>(node);
+        if(!atom || isSynthetic(atom) || !atom->NAME()) return -1;
+        return slotOf[atom->NAME()->getText()];
+    }
+
+    static JitType join(JitType a, JitType b) {
+        if(a == JitBad || b == JitBad) return JitBad;
+        return a == JitUnknown || b == JitUnknown ? JitUnknown : a;
+    }
+
+    // Int in r to double in xmm x; Ints beyond 2^53 would not convert the way BigInt::toDouble does.
+    void toDouble(int x, Asm::Reg r, JitType t) {
+        if(t == JitFloat) return as.toXmm(x, r);
+        as.mov(Asm::RDX, r), as.movImm(Asm::R8, 1ll << 53), as.add(Asm::RDX, Asm::R8);
+        as.movImm(Asm::R8, 1ll << 54), as.cmp(Asm::RDX, Asm::R8), as.jcc(Asm::A, bail);
+        as.cvtsi2sd(x, r);
+    }
+
+    void truth(JitType t) { // rax = 0 / 1
+        if(t == JitFloat) as.shl1(Asm::RAX); // drops the sign of -0.0
+        else as.test(Asm::RAX, Asm::RAX);
+        as.setcc(Asm::NE, Asm::RAX), as.movzx8(Asm::RAX);
+    }
+
+    // rax = rax op rcx
+    JitType binary(int op, JitType tl, JitType tr) {
+        const JitType t = join(tl, tr);
+        if(t == JitBad || t == JitUnknown) return t;
+        if(tl == JitBool || tr == JitBool) return JitBad;
+        if(tl == JitInt && tr == JitInt && op != Python3Parser::DIV) {
+            if(op == Python3Parser::ADD) as.add(Asm::RAX, Asm::RCX);
+            else if(op == Python3Parser::MINUS) as.sub(Asm::RAX, Asm::RCX);
+            else if(op == Python3Parser::STAR) as.imul(Asm::RAX, Asm::RCX);
+            else { // floor division and modulo, as BigInt does them
+                const int ok = as.label(), done = as.label();
+                as.test(Asm::RCX, Asm::RCX), as.jcc(Asm::E, bail);
+                as.immOp(7, Asm::RCX, -1), as.jcc(Asm::NE, ok);
+                as.movImm(Asm::RDX, INT64_MIN), as.cmp(Asm::RAX, Asm::RDX), as.jcc(Asm::E, bail);
+                as.bind(ok);
+                as.cqo(), as.idiv(Asm::RCX);
+                as.test(Asm::RDX, Asm::RDX), as.jcc(Asm::E, done);
+                as.mov(Asm::R8, Asm::RDX), as.xorr(Asm::R8, Asm::RCX), as.jcc(Asm::NS, done);
+                as.immOp(0, Asm::RAX, -1), as.add(Asm::RDX, Asm::RCX);
+                as.bind(done);
+                if(op == Python3Parser::MOD) as.mov(Asm::RAX, Asm::RDX);
+                return JitInt;
+            }
+            as.jcc(Asm::O, bail);
+            return JitInt;
+        }
+        if(op == Python3Parser::IDIV || op == Python3Parser::MOD) return JitBad; // Float operands read data_Int
+        toDouble(0, Asm::RAX, tl), toDouble(1, Asm::RCX, tr);
+        as.sse(op == Python3Parser::ADD ? 0x58 : op == Python3Parser::STAR ? 0x59 : op == Python3Parser::MINUS ? 0x5C : 0x5E, 0, 1);
+        as.fromXmm(Asm::RAX, 0);
+        return JitFloat;
+    }
+
+    // rdx = (rax op rcx), keeping rcx.
+    void compare(int op, JitType tl, JitType tr) {
+        if(tl == JitInt && tr == JitInt) {
+            as.cmp(Asm::RAX, Asm::RCX);
+            switch(op) {
+                case Python3Parser::LESS_THAN: as.setcc(Asm::L, Asm::RDX); break;
+                case Python3Parser::GREATER_THAN: as.setcc(Asm::G, Asm::RDX); break;
+                case Python3Parser::LT_EQ: as.setcc(Asm::LE, Asm::RDX); break;
+                case Python3Parser::GT_EQ: as.setcc(Asm::GE, Asm::RDX); break;
+                case Python3Parser::EQUALS: as.setcc(Asm::E, Asm::RDX); break;
+                default: as.setcc(Asm::NE, Asm::RDX);
+            }
+        } else {
+            toDouble(0, Asm::RAX, tl), toDouble(1, Asm::RCX, tr);
+            switch(op) {
+                case Python3Parser::LESS_THAN: as.ucomisd(1, 0), as.setcc(Asm::A, Asm::RDX); break;
+                case Python3Parser::GREATER_THAN: as.ucomisd(0, 1), as.setcc(Asm::A, Asm::RDX); break;
+                case Python3Parser::LT_EQ: as.ucomisd(1, 0), as.setcc(Asm::AE, Asm::RDX); break;
+                case Python3Parser::GT_EQ: as.ucomisd(0, 1), as.setcc(Asm::AE, Asm::RDX); break;
+                case Python3Parser::EQUALS:
+                    as.ucomisd(0, 1), as.setcc(Asm::E, Asm::RDX), as.setcc(Asm::NP, Asm::RAX), as.and8(Asm::RDX, Asm::RAX);
+                    break;
+                default: as.ucomisd(0, 1), as.setcc(Asm::NE, Asm::RDX), as.setcc(Asm::P, Asm::RAX), as.or8(Asm::RDX, Asm::RAX);
+            }
+        }
+        as.movzx8(Asm::RDX);
+    }
+
+    JitType variable(const string &nme) {
+        const int i = slotOf[nme], n = region->names.size();
+        if(region->types[i] == JitUnknown) return strict ? JitBad : JitUnknown;
+        if(region->maybeUnassigned[i]) as.load(Asm::RAX, Asm::RDI, n + i), as.test(Asm::RAX, Asm::RAX), as.jcc(Asm::E, bail);
+        as.load(Asm::RAX, Asm::RDI, i);
+        return region->types[i];
+    }
+
+    JitType atom(Python3Parser::AtomContext *ctx) {
+        if(isSynthetic(ctx)) {
+            const auto synthetic = static_cast<SyntheticAtom*>(ctx);
+            if(synthetic->kind != Constant) return expr(synthetic->origin);
+            const DataType &x = synthetic->value;
+            long long val;
+            if(x.tpe == Int && x.data_Int.toLongLong(val)) return as.movImm(Asm::RAX, val), JitInt;
+            if(x.tpe == Float) return memcpy(&val, &x.data_Float, 8), as.movImm(Asm::RAX, val), JitFloat;
+            if(x.tpe == Bool) return as.movImm(Asm::RAX, x.data_Bool), JitBool;
+            return JitBad;
+        }
+        if(ctx->NAME()) return variable(ctx->NAME()->getText());
+        if(ctx->test()) return expr(ctx->test());
+        return JitBad; // literals are all folded by now; strings and None are not ours anyway
+    }
+
+    JitType logic(antlr4::ParserRuleContext *ctx, bool isOr) {
+        if(ctx->children.size() == 1) return expr(ctx->children[0]);
+        const int done = as.label();
+        JitType ret = JitBool;
+        for(unsigned i = 0; i < ctx->children.size(); i += 2) {
+            const JitType t = expr(ctx->children[i]);
+            ret = join(ret, t);
+            truth(t), as.test(Asm::RAX, Asm::RAX), as.jcc(isOr ? Asm::NE : Asm::E, done);
+        }
+        as.bind(done);
+        return ret;
+    }
+
+    JitType comparison(Python3Parser::ComparisonContext *ctx) {
+        if(ctx->children.size() == 1) return expr(ctx->children[0]);
+        const int fail = as.label(), done = as.label();
+        JitType tl = expr(ctx->children[0]), ret = JitBool;
+        for(unsigned i = 1; i < ctx->children.size(); i += 2) {
+            as.push(Asm::RAX);
+            const JitType tr = expr(ctx->children[i + 1]);
+            as.mov(Asm::RCX, Asm::RAX), as.pop(Asm::RAX);
+            ret = join(ret, join(tl, tr));
+            if(tl == JitBool || tr == JitBool) ret = JitBad;
+            if(ret != JitBool) return ret;
+            compare(tokenOf(ctx->children[i]), tl, tr);
+            as.mov(Asm::RAX, Asm::RCX), as.test(Asm::RDX, Asm::RDX), as.jcc(Asm::E, fail);
+            tl = tr;
+        }
+        as.movEax(1), as.jmp(done);
+        as.bind(fail), as.movEax(0);
+        as.bind(done);
+        return JitBool;
+    }
+
+    // a chain of binary operators, left to right.
+    JitType chain(antlr4::ParserRuleContext *ctx) {
+        JitType tl = expr(ctx->children[0]);
+        for(unsigned i = 1; i < ctx->children.size(); i += 2) {
+            as.push(Asm::RAX);
+            const JitType tr = expr(ctx->children[i + 1]);
+            as.mov(Asm::RCX, Asm::RAX), as.pop(Asm::RAX);
+            tl = binary(tokenOf(ctx->children[i]), tl, tr);
+            if(tl == JitBad) return tl;
+        }
+        return tl;
+    }
+
+    JitType expr(antlr4::tree::ParseTree *node) {
+        const auto ctx = dynamic_cast<antlr4::ParserRuleContext*>(node);
+        if(!ctx) return JitBad;
+        switch(ctx->getRuleIndex()) {
+            case Python3Parser::RuleTest: return expr(ctx->children[0]);
+            case Python3Parser::RuleOr_test: return logic(ctx, 1);
+            case Python3Parser::RuleAnd_test: return logic(ctx, 0);
+            case Python3Parser::RuleNot_test: {
+                if(ctx->children.size() == 1) return expr(ctx->children[0]);
+                const JitType t = expr(ctx->children[1]);
+                truth(t), as.immOp(6, Asm::RAX, 1);
+                return join(JitBool, t);
+            }
+            case Python3Parser::RuleComparison: return comparison(static_cast<Python3Parser::ComparisonContext*>(ctx));
+            case Python3Parser::RuleArith_expr: case Python3Parser::RuleTerm: return chain(ctx);
+            case Python3Parser::RuleFactor: {
+                if(ctx->children.size() == 1) return expr(ctx->children[0]);
+                const JitType t = expr(ctx->children[1]);
+                if(t == JitBool) return JitBad;
+                if(tokenOf(ctx->children[0]) == Python3Parser::MINUS) {
+                    if(t == JitInt) as.neg(Asm::RAX), as.jcc(Asm::O, bail);
+                    else if(t == JitFloat) as.movImm(Asm::RCX, INT64_MIN), as.xorr(Asm::RAX, Asm::RCX);
+                }
+                return t;
+            }
+            case Python3Parser::RuleAtom_expr:
+                if(ctx->children.size() != 1) return JitBad; // calls may print or touch other frames
+                return expr(ctx->children[0]);
+            case Python3Parser::RuleAtom: return atom(static_cast<Python3Parser::AtomContext*>(ctx));
+            default: return JitBad;
+        }
+    }
+
+    bool assign(int slot, JitType t) {
+        if(t == JitBad || t == JitBool) return 0;
+        if(t == JitUnknown) return 1;
+        JitType &declared = region->types[slot];
+        if(declared == JitUnknown) declared = t, changed = 1;
+        if(declared != t) return 0;
+        as.store(Asm::RDI, slot, Asm::RAX);
+        if(region->maybeUnassigned[slot]) as.movImm(Asm::RDX, 1), as.store(Asm::RDI, region->names.size() + slot, Asm::RDX);
+        return 1;
+    }
+
+    bool exprStmt(Python3Parser::Expr_stmtContext *ctx) {
+        const auto lists = ctx->testlist();
+        for(auto t: lists) if(t->test().size() != 1) return 0;
+        if(ctx->augassign()) {
+            const int slot = nameSlot(lists[0]);
+            if(slot < 0) return 0;
+            static const map<int, int> binaryOf = {
+                {Python3Parser::ADD_ASSIGN, Python3Parser::ADD}, {Python3Parser::SUB_ASSIGN, Python3Parser::MINUS},
+                {Python3Parser::MULT_ASSIGN, Python3Parser::STAR}, {Python3Parser::DIV_ASSIGN, Python3Parser::DIV},
+                {Python3Parser::IDIV_ASSIGN, Python3Parser::IDIV}, {Python3Parser::MOD_ASSIGN, Python3Parser::MOD}};
+            const JitType tr = expr(lists[1]->test(0));
+            as.mov(Asm::RCX, Asm::RAX);
+            const JitType tl = variable(region->names[slot]);
+            return assign(slot, binary(binaryOf.at(tokenOf(ctx->augassign())), tl, tr));
+        }
+        if(lists.size() == 1) return expr(lists[0]->test(0)) != JitBad;
+        if(lists.size() != 2) return 0;
+        const int slot = nameSlot(lists[0]);
+        return slot >= 0 && assign(slot, expr(lists[1]->test(0)));
+    }
+
+    bool smallStmt(Python3Parser::Small_stmtContext *ctx) {
+        if(ctx->expr_stmt()) return exprStmt(ctx->expr_stmt());
+        const auto flow = ctx->flow_stmt();
+        if(flow->break_stmt() || flow->continue_stmt()) {
+            if(loops.empty()) return 0;
+            as.jmp(flow->break_stmt() ? loops.back().second : loops.back().first);
+            return 1;
+        }
+        if(!region->isFunction) return 0; // returning leaves the loop's frame behind
+        const auto ret = flow->return_stmt();
+        if(!ret->testlist()) return as.movEax(JitNone), as.jmp(exit), 1;
+        if(ret->testlist()->test().size() != 1) return 0;
+        const JitType t = expr(ret->testlist()->test(0));
+        if(t == JitBad || t == JitBool) return 0;
+        as.store(Asm::RDI, 2 * region->names.size(), Asm::RAX);
+        as.movEax(t == JitFloat ? JitReturnFloat : JitReturnInt), as.jmp(exit);
+        return 1;
+    }
+
+    bool suite(Python3Parser::SuiteContext *ctx) {
+        if(ctx->simple_stmt()) return smallStmt(ctx->simple_stmt()->small_stmt());
+        for(auto t: ctx->stmt()) if(!stmt(t)) return 0;
+        return 1;
+    }
+
+    bool whileStmt(Python3Parser::While_stmtContext *ctx, bool checkpoint) {
+        const int head = as.label(), end = as.label(), n = region->names.size();
+        as.bind(head);
+        if(checkpoint) for(int i = 0; i < 2 * n; i++) as.load(Asm::RAX, Asm::RDI, i), as.store(Asm::RSI, i, Asm::RAX);
+        const JitType t = expr(ctx->test());
+        if(t == JitBad) return 0;
+        truth(t), as.test(Asm::RAX, Asm::RAX), as.jcc(Asm::E, end);
+        loops.push_back(make_pair(head, end));
+        if(!suite(ctx->suite())) return 0;
+        loops.pop_back();
+        as.jmp(head), as.bind(end);
+        return 1;
+    }
+
+    bool stmt(Python3Parser::StmtContext *ctx) {
+        if(ctx->simple_stmt()) return smallStmt(ctx->simple_stmt()->small_stmt());
+        const auto compound = ctx->compound_stmt();
+        if(compound->while_stmt()) return whileStmt(compound->while_stmt(), 0);
+        if(!compound->if_stmt()) return 0; // nested def
+        const auto tests = compound->if_stmt()->test();
+        const auto suites = compound->if_stmt()->suite();
+        const int end = as.label();
+        for(unsigned i = 0; i < suites.size(); i++) {
+            const int next = as.label();
+            if(i < tests.size()) {
+                const JitType t = expr(tests[i]);
+                if(t == JitBad) return 0;
+                truth(t), as.test(Asm::RAX, Asm::RAX), as.jcc(Asm::E, next);
+            }
+            if(!suite(suites[i])) return 0;
+            as.jmp(end), as.bind(next);
+        }
+        as.bind(end);
+        return 1;
+    }
+
+    bool body(antlr4::ParserRuleContext *root) {
+        as.clear(), loops.clear();
+        bail = as.label(), exit = as.label();
+        as.push(Asm::RBP), as.mov(Asm::RBP, Asm::RSP);
+        if(region->isFunction) {
+            if(!suite(static_cast<Python3Parser::FuncdefContext*>(root)->suite())) return 0;
+        } else if(!whileStmt(static_cast<Python3Parser::While_stmtContext*>(root), 1)) return 0;
+        as.movEax(JitNone), as.jmp(exit);
+        as.bind(bail), as.movEax(JitBail);
+        as.bind(exit), as.mov(Asm::RSP, Asm::RBP), as.pop(Asm::RBP), as.ret();
+        as.resolve();
+        return 1;
+    }
+
+public:
+    // types come from the current values; names unassigned now get the type of what the region assigns them.
+    unique_ptr<JitRegion> compile(antlr4::ParserRuleContext *root, const function<Variable&(const string&)> &lookup) {
+        unique_ptr<JitRegion> ret(new JitRegion);
+        region = ret.get();
+        region->isFunction = dynamic_cast<Python3Parser::FuncdefContext*>(root);
+        set<string> names, assigned;
+        collect(region->isFunction ? (antlr4::ParserRuleContext*) static_cast<Python3Parser::FuncdefContext*>(root)->suite() : root, names, assigned);
+        if(region->isFunction && static_cast<Python3Parser::FuncdefContext*>(root)->parameters()->typedargslist())
+            for(auto t: static_cast<Python3Parser::FuncdefContext*>(root)->parameters()->typedargslist()->tfpdef()) names.insert(t->getText());
+        for(auto &t: names) {
+            slotOf[t] = region->names.size(), region->names.push_back(t), region->ids.push_back(symbols.intern(t));
+            region->written.push_back(assigned.count(t));
+            Variable &cell = lookup(t);
+            long long val;
+            if(!cell.isAssigned()) region->types.push_back(JitUnknown), region->maybeUnassigned.push_back(1);
+            else if(cell.getContent().tpe == Int && cell.getContent().data_Int.toLongLong(val)) region->types.push_back(JitInt), region->maybeUnassigned.push_back(0);
+            else if(cell.getContent().tpe == Float) region->types.push_back(JitFloat), region->maybeUnassigned.push_back(0);
+            else return nullptr;
+        }
+        strict = 0;
+        for(unsigned round = 0; round <= names.size(); round++) {
+            changed = 0;
+            if(!body(root)) return nullptr;
+            if(!changed) break;
+        }
+        strict = 1;
+        if(!body(root)) return nullptr;
+        region->code.reset(new ExecutableCode(as.code));
+        if(!region->code->entry()) return nullptr;
+        return ret;
+    }
+};
+
+#endif
+
+class Jit {
+public:
+    struct Hotness {
+        unsigned count;
+        bool rejected;
+        unique_ptr<JitRegion> region;
+        Hotness(): count(0), rejected(0) {}
+        inline bool tick(unsigned threshold) {
+            return !rejected && ++count >= threshold;
+        }
+    };
+    static constexpr unsigned loopThreshold = 64, callThreshold = 4; // iterations of a loop, calls of a function
+    bool enabled;
+    map<antlr4::ParserRuleContext*, Hotness> regions;
+
+    Jit(): enabled(0) {}
+
+    Hotness& hotness(antlr4::ParserRuleContext *ctx) {
+        return regions[ctx];
+    }
+
+    // drops the entries for a tree about to be freed, whose addresses may be reused by later nodes.
+    void forget(antlr4::tree::ParseTree *node) {
+        if(regions.empty()) return;
+        if(auto ctx = dynamic_cast<antlr4::ParserRuleContext*>(node)) regions.erase(ctx);
+        for(auto child: node->children) forget(child);
+    }
+
+    // root is a While_stmtContext or a FuncdefContext; lookup gives the Variable a name has right now.
+    void compile(Hotness &hot, antlr4::ParserRuleContext *root, const function<Variable&(const string&)> &lookup) {
+#ifdef PYTHON_INTERPRETER_JIT_NATIVE
+        hot.region = JitCompiler().compile(root, lookup);
+#endif
+        hot.rejected = !hot.region;
+    }
+};
+
+#endif //PYTHON_INTERPRETER_JIT_HPP
@@ -1,20 +1,138 @@
 #include <iostream>
+#include <cstring>
 #include "antlr4-runtime.h"
 #include "Python3Lexer.h"
 #include "Python3Parser.h"
 #include "Evalvisitor.h"
+#include "dfaCache.hpp"
+#include "heapCounter.hpp"
+#include "optimizer.hpp"
+#include "programCache.hpp"
+#include "programPrinter.hpp"
+#include "scriptLexer.hpp"
+#include "scriptParser.hpp"
+#include "sourceStream.hpp"
+#include "startupStats.hpp"
+#include "statementStream.hpp"
+#include "transpiler.hpp"
+#include "typeInference.hpp"
 using namespace antlr4;
 //todo: regenerating files in directory named "generated" is dangerous.
 //       if you really need to regenerate,please ask TA for help.
 int main(int argc, const char* argv[]){
+    StartupStats::instance().mark("static initialization");
+    bool typeReport = 0, dumpOptimized = 0, emitCpp = 0, stream = 0, checkLexer = 0, checkParser = 0, showParseStats = 0, showStartupStats = 0;
+    const char *path = nullptr, *programCacheDir = nullptr;
+    std::unique_ptr<DfaCache> dfaCache;
+    for(int i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "--type-report")) typeReport = 1; // list what TypeInferer specialized on stderr
+        else if(!strcmp(argv[i], "--dump-optimized")) dumpOptimized = 1; // print the folded program instead of running it
+        else if(!strcmp(argv[i], "--emit-cpp")) emitCpp = 1; // print a C++ translation instead of running it
+        else if(!strcmp(argv[i], "--check-lexer")) checkLexer = 1; // compare ScriptLexer's tokens with Python3Lexer's
+        else if(!strcmp(argv[i], "--check-parser")) checkParser = 1; // compare ScriptParser's tree with Python3Parser's
+        else if(!strcmp(argv[i], "--parse-stats")) showParseStats = 1; // report which parser stage produced the tree, and parse times
+        else if(!strcmp(argv[i], "--dfa-cache") && i + 1 < argc) dfaCache.reset(new DfaCache(argv[++i])); // keep ANTLR's prediction DFAs across runs
+        else if(!strcmp(argv[i], "--program-cache") && i + 1 < argc) programCacheDir = argv[++i]; // keep optimized trees across runs, by source hash
+        else if(!strcmp(argv[i], "--startup-stats")) showStartupStats = 1; // time the phases before the first statement runs
+        else if(!strcmp(argv[i], "--alloc-stats")) atexit([] {slabAllocator.report(std::cerr), digitPool.report(std::cerr), frameArena.report(std::cerr), heapCounter.report(std::cerr);}); // count slab, digit pool, arena and heap allocations, reported at exit
+        else if(!strcmp(argv[i], "--stream")) stream = 1; // parse and run one top-level statement at a time
+        else if(!strcmp(argv[i], "--line-buffered")) OutputWriter::instance().lineBuffered = 1; // flush print output line by line
+        else if(!strcmp(argv[i], "--jit")) jit.enabled = 1; // compile hot loops and functions to machine code
+        else if(argv[i][0] != '-' && !path) path = argv[i]; // read the program from a file instead of stdin
+        else {
+            std::cerr << "usage: " << argv[0] << " [--type-report] [--dump-optimized] [--emit-cpp] [--stream] [--check-lexer] [--check-parser] [--parse-stats] [--dfa-cache file] [--program-cache dir] [--startup-stats] [--alloc-stats] [--jit] [--line-buffered] [program.py | < program.py]" << std::endl;
+            return 2;
+        }
+    }
+    OutputWriter::instance().install();
+    SourceBuffer source;
+    if(path ? !source.open(path) : !source.readStdin()) {
+        std::cerr << argv[0] << ": cannot read " << (path ? path : "stdin") << ": " << strerror(errno) << std::endl;
+        return 1;
+    }
+    StartupStats::instance().mark("read the program");
     //todo:please don't modify the code below the construction of ifs if you want to use visitor mode
-    ANTLRInputStream input(std::cin);
-    Python3Lexer lexer(&input);
+    Utf8CharStream input(source.data(), source.size(), path ? path : "");
+    ParseArena tracker; // tokens and tree nodes; declared first, as it must outlive the streams and trees that use it
+    ScriptLexer lexer(input);
+    if(checkLexer) {
+        Utf8CharStream reference(source.data(), source.size(), path ? path : "");
+        Python3Lexer antlrLexer(&reference);
+        if(dfaCache) dfaCache->attach(antlrLexer);
+        return sameTokens(lexer, antlrLexer, std::cerr) ? 0 : 1;
+    }
+    if(stream && !emitCpp && !checkParser) { // --emit-cpp needs the whole program
+        StatementRunner runner(dfaCache.get());
+        runner.run(lexer, dumpOptimized ? &std::cout : nullptr, typeReport ? &std::cerr : nullptr, showStartupStats ? &std::cerr : nullptr);
+        if(typeReport) std::cerr << runner.counted << " counted loops, " << runner.hoisted << " hoisted expressions, " << runner.rewritten << " appends" << std::endl;
+        if(showParseStats) runner.parseStats.report(std::cerr);
+        return 0;
+    }
+    lexer.allocateFrom(tracker); // --stream frees each statement's tokens once it ran, so they stay on the heap
     CommonTokenStream tokens(&lexer);
-    tokens.fill();
-    Python3Parser parser(&tokens);
-    tree::ParseTree* tree=parser.file_input();
+    AntlrParser parser(tokens, dfaCache.get());
+    ParseStats parseStats;
+    std::unique_ptr<ProgramCache> programCache;
+    tree::ParseTree* tree=nullptr;
+    bool optimized = 0; // a tree from the program cache has been through the passes already
+    if(programCacheDir && !checkParser && !emitCpp && !dumpOptimized && !typeReport) { // those want the passes to run
+        const auto start = std::chrono::steady_clock::now();
+        programCache.reset(new ProgramCache(programCacheDir, source.data(), source.size()));
+        if((tree = programCache->load(&lexer, &input, tracker))) parseStats.cached++, optimized = 1;
+        parseStats.cacheTime += secondsSince(start);
+    }
+    if(!tree) tokens.fill();
+    if(checkParser) {
+        ScriptParser scriptParser(tokens, tracker);
+        tree::ParseTree* tree=scriptParser.file_input();
+        tree::ParseTree* reference=parseWithAntlr(parser.get(), parseStats);
+        parseStats.count(tracker);
+        if(showParseStats) parseStats.report(std::cerr);
+        const bool rejected = parser.syntaxErrors();
+        if(!tree) std::cerr << "ScriptParser: " << scriptParser.error << std::endl;
+        if(!tree || rejected) return !tree == rejected ? 0 : 1; // both must reject the program
+        return sameTrees(tree, reference, &parser.get(), std::cerr) ? (std::cerr << "trees match" << std::endl, 0) : 1;
+    }
+    if(!tree) tree=parseProgram(tokens, tracker, parser, parseStats);
+    parseStats.count(tracker);
+    if(showParseStats) parseStats.report(std::cerr);
+    shadowBuiltins(tree);
+    StartupStats::instance().mark("lex and parse");
+    if(parser.syntaxErrors()) { // the tree ANTLR recovered may lack nodes the passes and the JIT rely on, so it runs as parsed
+        if(emitCpp || dumpOptimized) return 1;
+        jit.enabled = 0;
+        EvalVisitor visitor;
+        visitor.visit(tree);
+        return 0;
+    }
+    if(!optimized) {
+        ConstantFolder folder(tracker);
+        folder.run(tree);
+        if(emitCpp) {
+            CppTranspiler transpiler(std::cout);
+            if(transpiler.run(tree)) return 0;
+            std::cerr << "--emit-cpp: " << transpiler.error << std::endl;
+            return 1;
+        }
+        LoopOptimizer loops(tracker);
+        loops.run(tree);
+        if(dumpOptimized) {
+            ProgramPrinter(std::cout).program(tree);
+            return 0;
+        }
+        TypeInferer inferer;
+        inferer.run(tree, tracker);
+        AppendRewriter appends(tracker);
+        appends.run(tree);
+        if(typeReport) {
+            inferer.report(std::cerr);
+            std::cerr << loops.counted << " counted loops, " << loops.hoisted << " hoisted expressions, " << appends.rewritten << " appends" << std::endl;
+        }
+        if(programCache && !programCache->store(tree, tokens.getTokens()))
+            std::cerr << "cannot write program cache " << programCache->file() << ": " << strerror(errno) << std::endl;
+    }
+    if(showStartupStats) StartupStats::instance().mark("optimize"), StartupStats::instance().report(std::cerr);
     EvalVisitor visitor;
     visitor.visit(tree);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,492 @@
+#ifndef PYTHON_INTERPRETER_OPTIMIZER_HPP
+#define PYTHON_INTERPRETER_OPTIMIZER_HPP
+
+#include "Evalvisitor.h"
+#include "syntheticNodes.hpp"
+#include "treeUtils.hpp"
+#include <map>
+
+// Rewrites the parse tree before execution:
+//  - constant subexpressions (literals, operators over literals, int/float/str/bool of a literal) are
+//    evaluated once by EvalVisitor itself, so they keep the exact DataType semantics, and replaced by
+//    Constant synthetic atoms;
+//  - if/elif branches with constant tests and constant-false while loops are removed;
+//  - statements following return/break/continue in the same suite are dropped.
+// Operations that never terminate or read garbage in DataType (e.g. "a" + 1, x // 0) are left to run time.
+class ConstantFolder {
+private:
+    EvalVisitor evaluator;
+    ParseArena &tracker;
+    map<antlr4::tree::ParseTree*, DataType> values; // nodes found to be constant
+    static constexpr size_t maxFoldedString = 4096;
+
+    static inline bool isNumber(const DataType &x) {
+        return x.tpe == Bool || x.tpe == Int || x.tpe == Float;
+    }
+
+    static inline bool isIntegral(const DataType &x) {
+        return x.tpe == Bool || x.tpe == Int;
+    }
+
+    bool safeBinary(const DataType &a, const DataType &b, size_t op) {
+        switch(op) {
+            case Python3Parser::ADD: return (isNumber(a) && isNumber(b)) || (a.tpe == String && b.tpe == String);
+            case Python3Parser::MINUS: case Python3Parser::DIV: return isNumber(a) && isNumber(b);
+            case Python3Parser::STAR: {
+                if(isNumber(a) && isNumber(b)) return 1;
+                const DataType &str = a.tpe == String ? a : b, &cnt = a.tpe == String ? b : a;
+                if(str.tpe != String || !isNumber(cnt)) return 0;
+                long long n;
+                if(!cnt.toInt().data_Int.toLongLong(n) || n > (long long) maxFoldedString) return 0;
+                return str.data_String.length() * (size_t) max(0ll, n) <= maxFoldedString;
+            }
+            case Python3Parser::IDIV: case Python3Parser::MOD:
+                return isIntegral(a) && isIntegral(b) && b.toInt().data_Int.toBool();
+            case Python3Parser::EQUALS: case Python3Parser::NOT_EQ_2: return 1;
+            default: // ordering comparisons
+                return (isNumber(a) && isNumber(b)) || (a.tpe == String && b.tpe == String);
+        }
+    }
+
+    void replace(antlr4::ParserRuleContext *node) {
+        auto atom = tracker.createInstance<SyntheticAtom>(Constant, node);
+        atom->value = values[node];
+        replaceWithAtom(node, atom, tracker);
+        ++folded;
+    }
+
+    bool record(antlr4::ParserRuleContext *node) {
+        values[node] = evaluator.visit(node).as<DataType>();
+        return 1;
+    }
+
+    // fold below node; returns whether node itself is constant (its parent decides on replacing it).
+    bool fold(antlr4::ParserRuleContext *node) {
+        const auto rule = node->getRuleIndex();
+        if(rule == Python3Parser::RuleAtom) {
+            const auto ctx = static_cast<Python3Parser::AtomContext*>(node);
+            if(isSynthetic(ctx)) {
+                const auto atom = static_cast<SyntheticAtom*>(ctx);
+                if(atom->kind != Constant) return 0;
+                values[node] = atom->value;
+                return 1;
+            }
+            if(ctx->NAME()) return 0;
+            if(ctx->test()) return fold(ctx->test()) && record(node);
+            return record(node);
+        }
+        if(rule == Python3Parser::RuleAtom_expr) {
+            const auto ctx = static_cast<Python3Parser::Atom_exprContext*>(node);
+            if(!ctx->trailer()) return fold(ctx->atom()) && record(node);
+            if(isSubscript(ctx->trailer())) { // left to run time, which reports a bad index where it happens
+                fold(ctx->atom());
+                for(auto t: ctx->trailer()->children)
+                    if(auto test = dynamic_cast<Python3Parser::TestContext*>(t)) if(fold(test)) replace(test);
+                return 0;
+            }
+            if(!ctx->trailer()->arglist()) return 0;
+            const auto args = ctx->trailer()->arglist()->argument();
+            vector<bool> isConst;
+            for(auto t: args) isConst.push_back(fold(t->test()));
+            const string function_Name = ctx->atom()->getText();
+            if((function_Name == "int" || function_Name == "float" || function_Name == "str" || function_Name == "bool") &&
+               isBuiltinFunction(function_Name) && args.size() == 1 && !args[0]->NAME() && isConst[0]) return record(node);
+            for(unsigned i = 0; i < args.size(); i++) if(isConst[i]) replace(args[i]->test());
+            return 0;
+        }
+        if(rule == Python3Parser::RuleFactor) {
+            const auto ctx = static_cast<Python3Parser::FactorContext*>(node);
+            if(!ctx->addsub_op()) return fold(ctx->atom_expr()) && record(node);
+            return fold(ctx->factor()) && record(node);
+        }
+        // binary levels: operands are the rule-context children, operators the terminals or *_op contexts between them.
+        vector<antlr4::ParserRuleContext*> operands;
+        vector<size_t> ops;
+        for(auto child: node->children) {
+            auto sub = dynamic_cast<antlr4::ParserRuleContext*>(child);
+            if(sub && sub->getRuleIndex() != Python3Parser::RuleComp_op && sub->getRuleIndex() != Python3Parser::RuleAddsub_op &&
+               sub->getRuleIndex() != Python3Parser::RuleMuls_op) operands.push_back(sub);
+            else ops.push_back(sub ? sub->getStart()->getType() : static_cast<antlr4::tree::TerminalNode*>(child)->getSymbol()->getType());
+        }
+        vector<bool> isConst;
+        bool all = 1;
+        for(auto t: operands) isConst.push_back(fold(t)), all = all && isConst.back();
+        if(all && (rule == Python3Parser::RuleArith_expr || rule == Python3Parser::RuleTerm)) {
+            DataType acc = values[operands[0]];
+            for(unsigned i = 0; all && i < ops.size(); i++) {
+                const DataType &hr = values[operands[i + 1]];
+                all = safeBinary(acc, hr, ops[i]);
+                if(!all) break;
+                if(ops[i] == Python3Parser::ADD) acc = acc + hr;
+                else if(ops[i] == Python3Parser::MINUS) acc = acc - hr;
+                else if(ops[i] == Python3Parser::STAR) acc = acc * hr;
+                else if(ops[i] == Python3Parser::DIV) acc = acc / hr;
+                else if(ops[i] == Python3Parser::IDIV) acc = dualDiv(acc, hr);
+                else acc = acc % hr;
+            }
+        } else if(all && rule == Python3Parser::RuleComparison) {
+            for(unsigned i = 0; all && i < ops.size(); i++) all = safeBinary(values[operands[i]], values[operands[i + 1]], ops[i]);
+        }
+        if(all) return record(node);
+        for(unsigned i = 0; i < operands.size(); i++) if(isConst[i]) replace(operands[i]);
+        return 0;
+    }
+
+    // fold an expression whose parent is not an expression (argument, testlist, statement...).
+    void foldTop(antlr4::ParserRuleContext *node) {
+        if(fold(node)) replace(node);
+    }
+
+    static bool isFlowStmt(Python3Parser::StmtContext *stmt) {
+        return stmt->simple_stmt() && stmt->simple_stmt()->small_stmt()->flow_stmt();
+    }
+
+    // statements a constant-true branch stands for, ready to be spliced into the enclosing block.
+    vector<antlr4::tree::ParseTree*> statementsOf(Python3Parser::SuiteContext *suite) {
+        vector<antlr4::tree::ParseTree*> ret;
+        if(suite->simple_stmt()) {
+            auto stmt = tracker.createInstance<Python3Parser::StmtContext>(nullptr, -1);
+            stmt->addChild(suite->simple_stmt()), suite->simple_stmt()->parent = stmt;
+            ret.push_back(stmt);
+        } else for(auto t: suite->stmt()) ret.push_back(t);
+        return ret;
+    }
+
+    // returns the statements stmt is replaced by (itself when unchanged).
+    vector<antlr4::tree::ParseTree*> optimizeStmt(Python3Parser::StmtContext *stmt) {
+        if(stmt->simple_stmt()) {
+            optimizeSimple(stmt->simple_stmt());
+            return {stmt};
+        }
+        const auto compound = stmt->compound_stmt();
+        if(compound->funcdef()) {
+            const auto def = compound->funcdef();
+            if(def->parameters()->typedargslist())
+                for(auto t: def->parameters()->typedargslist()->test()) foldTop(t);
+            optimizeSuite(def->suite());
+            return {stmt};
+        }
+        if(compound->while_stmt()) {
+            const auto loop = compound->while_stmt();
+            if(fold(loop->test())) {
+                if(!values[loop->test()].toBool().data_Bool) {
+                    ++removed;
+                    return {};
+                }
+                replace(loop->test());
+            }
+            optimizeSuite(loop->suite());
+            return {stmt};
+        }
+        const auto ctx = compound->if_stmt();
+        const auto ls_test = ctx->test();
+        const auto ls_suite = ctx->suite();
+        vector<antlr4::tree::ParseTree*> kept;
+        Python3Parser::SuiteContext *otherwise = ls_suite.size() > ls_test.size() ? ls_suite.back() : nullptr;
+        for(unsigned i = 0; i < ls_test.size(); i++) {
+            const auto at = find(ctx->children.begin(), ctx->children.end(), ls_test[i]) - ctx->children.begin();
+            if(fold(ls_test[i])) {
+                ++removed;
+                if(!values[ls_test[i]].toBool().data_Bool) continue;
+                otherwise = ls_suite[i]; // everything after a constant-true test is dead
+                break;
+            }
+            optimizeSuite(ls_suite[i]);
+            kept.insert(kept.end(), ctx->children.begin() + at - 1, ctx->children.begin() + at + 3);
+        }
+        if(otherwise) optimizeSuite(otherwise);
+        if(kept.empty()) {
+            if(otherwise) return statementsOf(otherwise);
+            return {};
+        }
+        if(otherwise) {
+            kept.push_back(ctx->children[0]), kept.push_back(ctx->children[2]); // keyword and ':' are only printed
+            kept.push_back(otherwise);
+        }
+        ctx->children = kept;
+        for(auto t: kept) t->parent = ctx;
+        return {stmt};
+    }
+
+    void optimizeSimple(Python3Parser::Simple_stmtContext *ctx) {
+        const auto small = ctx->small_stmt();
+        if(small->expr_stmt()) {
+            const auto testLists = small->expr_stmt()->testlist();
+            for(auto t: testLists.back()->test()) foldTop(t); // targets stay names
+        } else if(small->flow_stmt()->return_stmt() && small->flow_stmt()->return_stmt()->testlist()) {
+            for(auto t: small->flow_stmt()->return_stmt()->testlist()->test()) foldTop(t);
+        }
+    }
+
+    // optimize the statements of a block in place; stops the block at its first return/break/continue.
+    void optimizeBlock(antlr4::ParserRuleContext *block, bool cutAfterFlow) {
+        vector<antlr4::tree::ParseTree*> children;
+        bool dead = 0;
+        for(auto child: block->children) {
+            auto stmt = dynamic_cast<Python3Parser::StmtContext*>(child);
+            if(!stmt) {
+                children.push_back(child);
+                continue;
+            }
+            if(dead) {
+                ++removed;
+                continue;
+            }
+            for(auto t: optimizeStmt(stmt)) children.push_back(t), t->parent = block;
+            dead = cutAfterFlow && isFlowStmt(stmt);
+        }
+        block->children = children;
+    }
+
+    void optimizeSuite(Python3Parser::SuiteContext *suite) {
+        if(suite->simple_stmt()) optimizeSimple(suite->simple_stmt());
+        else optimizeBlock(suite, 1);
+    }
+
+public:
+    int folded, removed;
+    explicit ConstantFolder(ParseArena &_tracker): tracker(_tracker) {
+        folded = removed = 0;
+    }
+
+    void run(antlr4::tree::ParseTree *tree) {
+        optimizeBlock(static_cast<antlr4::ParserRuleContext*>(tree), 0); // top-level flow statements are left alone
+    }
+};
+
+// Loop-invariant code motion and induction variables for while loops; runs after ConstantFolder.
+//  - maximal subexpressions of a loop that read no name the loop may change (names it assigns, plus the
+//    ones a call may clobber when it calls user functions) are wrapped in Hoisted atoms. They are evaluated
+//    the first time they are reached in an activation of the loop and reused afterwards, so nothing is
+//    evaluated that the original loop would not have evaluated.
+//  - for `while i < N:` whose body steps i by an Int constant in a single top-level statement, the
+//    PlannedLoop records i, N and the step so EvalVisitor can run the counter as a long long.
+class LoopOptimizer {
+private:
+    ParseArena &tracker;
+    set<string> clobbered, variant;
+    bool clobbersAll; // a call may assign any name, as it may reach functions not seen yet
+    PlannedLoop *current;
+
+    static bool isHoistable(antlr4::ParserRuleContext *node) {
+        switch(node->getRuleIndex()) {
+            case Python3Parser::RuleTest: case Python3Parser::RuleOr_test: case Python3Parser::RuleAnd_test:
+            case Python3Parser::RuleNot_test: case Python3Parser::RuleComparison: case Python3Parser::RuleArith_expr:
+            case Python3Parser::RuleTerm: case Python3Parser::RuleFactor: case Python3Parser::RuleAtom_expr: return 1;
+            default: return 0;
+        }
+    }
+
+    // a chain ending in a plain atom costs no more to evaluate than a cached value.
+    static bool isCheap(antlr4::tree::ParseTree *node) {
+        while(node->children.size() == 1) node = node->children[0];
+        return node->children.empty() || dynamic_cast<Python3Parser::AtomContext*>(node);
+    }
+
+    // the atom at the bottom of a single-child chain, if there is one.
+    static Python3Parser::AtomContext* atomBelow(antlr4::tree::ParseTree *node) {
+        while(node->children.size() == 1 && !dynamic_cast<Python3Parser::AtomContext*>(node)) node = node->children[0];
+        return dynamic_cast<Python3Parser::AtomContext*>(node);
+    }
+
+    static bool isConversion(Python3Parser::Atom_exprContext *ctx) {
+        const string function_Name = ctx->atom()->getText();
+        return function_Name != "print" && isBuiltinFunction(function_Name);
+    }
+
+    void hoist(antlr4::ParserRuleContext *node) {
+        auto atom = tracker.createInstance<SyntheticAtom>(Hoisted, node);
+        atom->loop = current;
+        replaceWithAtom(node, atom, tracker);
+        node->parent = atom;
+        ++hoisted;
+    }
+
+    void hoistWithin(antlr4::ParserRuleContext *node) {
+        if(isHoistable(node) && !isCheap(node)) return hoist(node);
+        for(auto child: node->children)
+            if(auto sub = dynamic_cast<antlr4::ParserRuleContext*>(child)) hoistWithin(sub);
+    }
+
+    // returns whether node is invariant; invariant parts of a variant node are hoisted on the way.
+    bool scan(antlr4::ParserRuleContext *node) {
+        if(node->getRuleIndex() == Python3Parser::RuleAtom) {
+            const auto atom = static_cast<Python3Parser::AtomContext*>(node);
+            if(isSynthetic(atom)) return 1; // a constant, or hoisted by an enclosing loop
+            if(atom->NAME()) return !variant.count(atom->NAME()->getText());
+            if(atom->test()) return scan(atom->test());
+            return 1;
+        }
+        bool all = 1;
+        if(node->getRuleIndex() == Python3Parser::RuleAtom_expr) {
+            const auto call = static_cast<Python3Parser::Atom_exprContext*>(node);
+            if(call->trailer() && !isSubscript(call->trailer()) && !isConversion(call)) all = 0;
+        }
+        vector<antlr4::ParserRuleContext*> subs;
+        vector<bool> invariant;
+        for(auto child: node->children)
+            if(auto sub = dynamic_cast<antlr4::ParserRuleContext*>(child)) {
+                subs.push_back(sub), invariant.push_back(scan(sub));
+                all = all && invariant.back();
+            }
+        if(all) return 1;
+        for(unsigned i = 0; i < subs.size(); i++) if(invariant[i]) hoistWithin(subs[i]);
+        return 0;
+    }
+
+    void hoistIn(antlr4::ParserRuleContext *root) {
+        if(scan(root)) hoistWithin(root);
+    }
+
+    void hoistStatements(antlr4::tree::ParseTree *node) {
+        if(dynamic_cast<Python3Parser::FuncdefContext*>(node)) return; // runs in another frame
+        if(auto stmt = dynamic_cast<Python3Parser::Expr_stmtContext*>(node)) {
+            for(auto t: stmt->testlist().back()->test()) hoistIn(t); // targets stay names
+            return;
+        }
+        if(auto test = dynamic_cast<Python3Parser::TestContext*>(node)) return hoistIn(test);
+        for(unsigned i = 0; i < node->children.size(); i++) hoistStatements(node->children[i]);
+    }
+
+    static void assignmentsTo(antlr4::tree::ParseTree *node, const string &nme, vector<Python3Parser::Expr_stmtContext*> &ret) {
+        if(dynamic_cast<Python3Parser::FuncdefContext*>(node)) return;
+        if(auto stmt = dynamic_cast<Python3Parser::Expr_stmtContext*>(node)) {
+            set<string> targets;
+            collectTargets(stmt, targets);
+            if(targets.count(nme)) ret.push_back(stmt);
+            return;
+        }
+        for(auto child: node->children) assignmentsTo(child, nme, ret);
+    }
+
+    bool readsVariant(antlr4::tree::ParseTree *node) {
+        if(auto atom = dynamic_cast<Python3Parser::AtomContext*>(node))
+            if(atom->NAME()) return variant.count(atom->NAME()->getText());
+        if(auto call = dynamic_cast<Python3Parser::Atom_exprContext*>(node))
+            if(call->trailer() && !isSubscript(call->trailer()) && !isConversion(call)) return 1;
+        for(auto child: node->children) if(readsVariant(child)) return 1;
+        return 0;
+    }
+
+    bool findInduction(PlannedLoop *loop, bool calls) {
+        antlr4::tree::ParseTree *node = loop->test();
+        while(node->children.size() == 1) node = node->children[0];
+        const auto cond = dynamic_cast<Python3Parser::ComparisonContext*>(node);
+        if(!cond || cond->comp_op().size() != 1 || loop->suite()->simple_stmt()) return 0;
+        const auto op = cond->comp_op(0)->getStart()->getType();
+        if(op != Python3Parser::LESS_THAN && op != Python3Parser::GREATER_THAN && op != Python3Parser::LT_EQ && op != Python3Parser::GT_EQ) return 0;
+        const auto counter = atomBelow(cond->arith_expr(0));
+        if(!counter || isSynthetic(counter) || !counter->NAME() || readsVariant(cond->arith_expr(1))) return 0;
+        const string nme = counter->NAME()->getText();
+        if(calls && clobbered.count(nme)) return 0;
+        vector<Python3Parser::Expr_stmtContext*> writes;
+        assignmentsTo(loop->suite(), nme, writes);
+        if(writes.size() != 1 || !writes[0]->augassign()) return 0;
+        const auto kind = writes[0]->augassign()->getStart()->getType();
+        const auto step = atomBelow(writes[0]->testlist(1));
+        if(kind != Python3Parser::ADD_ASSIGN && kind != Python3Parser::SUB_ASSIGN) return 0;
+        if(!step || !isSynthetic(step) || static_cast<SyntheticAtom*>(step)->kind != Constant) return 0;
+        const DataType &k = static_cast<SyntheticAtom*>(step)->value;
+        long long stride;
+        if(k.tpe != Int || !k.data_Int.toLongLong(stride) || stride > INT_MAX || stride < -INT_MAX) return 0;
+        auto stmt = writes[0]->parent->parent->parent; // small_stmt, simple_stmt, stmt
+        if(stmt->parent != loop->suite()) return 0;
+        loop->counter = nme, loop->cond = cond;
+        loop->step = static_cast<Python3Parser::StmtContext*>(stmt);
+        loop->stride = kind == Python3Parser::ADD_ASSIGN ? stride : -stride;
+        return 1;
+    }
+
+    void plan(Python3Parser::While_stmtContext *loop) {
+        auto planned = tracker.createInstance<PlannedLoop>();
+        planned->children = loop->children;
+        for(auto t: planned->children) t->parent = planned;
+        planned->start = loop->start, planned->stop = loop->stop;
+        replaceChild(loop, planned);
+
+        variant.clear();
+        collectAssigned(planned, variant);
+        const bool calls = containsUserCall(planned);
+        if(calls && clobbersAll) return; // any name may change: nothing is invariant, no counter can be trusted
+        if(calls) variant.insert(clobbered.begin(), clobbered.end());
+        current = planned;
+        hoistStatements(planned->test());
+        hoistStatements(planned->suite());
+        if(findInduction(planned, calls)) ++counted;
+    }
+
+    void visit(antlr4::tree::ParseTree *node) {
+        if(auto loop = dynamic_cast<Python3Parser::While_stmtContext*>(node)) {
+            if(!dynamic_cast<PlannedLoop*>(loop)) plan(loop);
+            node = node->parent->children[0]; // the PlannedLoop now in its place
+        }
+        for(unsigned i = 0; i < node->children.size(); i++) visit(node->children[i]);
+    }
+
+public:
+    int hoisted, counted;
+    explicit LoopOptimizer(ParseArena &_tracker): tracker(_tracker) {
+        hoisted = counted = 0, clobbersAll = 0, current = nullptr;
+    }
+
+    void run(antlr4::tree::ParseTree *tree) {
+        clobbered = clobberedByCalls(tree);
+        visit(tree);
+    }
+    // for one statement of a program run piecewise: a call may reach functions later statements define, so it
+    // may assign any name.
+    void runStatement(antlr4::tree::ParseTree *tree) {
+        clobbersAll = 1;
+        visit(tree);
+    }
+};
+
+// `s = s + e` becomes an AppendStmt, run as `s += e`: a string then grows in place instead of being copied
+// into a new one at every step. Runs after TypeInferer, so the sums it specialized stay with it. Left alone
+// when e may call a user function, which could assign s after the original would have read it.
+class AppendRewriter {
+private:
+    ParseArena &tracker;
+
+    // the symbol id of the name a single-child chain ends in, or -1.
+    static int nameBelow(antlr4::tree::ParseTree *node) {
+        while(node->children.size() == 1) node = node->children[0];
+        const auto leaf = dynamic_cast<antlr4::tree::TerminalNode*>(node);
+        return leaf && leaf->getSymbol()->getType() == Python3Parser::NAME ? symbolOf(leaf->getSymbol()) : -1;
+    }
+
+    void rewrite(Python3Parser::Expr_stmtContext *stmt) {
+        if(stmt->children.size() != 3 || stmt->augassign()) return;
+        const auto lhs = stmt->testlist(0), rhs = stmt->testlist(1);
+        if(lhs->children.size() != 1 || rhs->children.size() != 1) return;
+        const int target = nameBelow(lhs);
+        antlr4::tree::ParseTree *node = rhs;
+        while(node->children.size() == 1) node = node->children[0];
+        const auto sum = dynamic_cast<Python3Parser::Arith_exprContext*>(node);
+        if(target < 0 || !sum || sum->children.size() != 3) return;
+        if(static_cast<Python3Parser::Addsub_opContext*>(sum->children[1])->getStart()->getType() != Python3Parser::ADD) return;
+        const auto operand = static_cast<Python3Parser::TermContext*>(sum->children[2]);
+        if(nameBelow(sum->children[0]) != target || containsUserCall(operand)) return;
+        auto append = tracker.createInstance<AppendStmt>(target, operand);
+        append->children = stmt->children;
+        for(auto t: append->children) t->parent = append;
+        append->start = stmt->start, append->stop = stmt->stop;
+        replaceChild(stmt, append);
+        ++rewritten;
+    }
+
+    void visit(antlr4::tree::ParseTree *node) {
+        if(auto stmt = dynamic_cast<Python3Parser::Expr_stmtContext*>(node)) return rewrite(stmt);
+        for(auto child: node->children) visit(child);
+    }
+
+public:
+    int rewritten;
+    explicit AppendRewriter(ParseArena &_tracker): tracker(_tracker), rewritten(0) {}
+
+    void run(antlr4::tree::ParseTree *tree) {
+        visit(tree);
+    }
+};
+
+#endif //PYTHON_INTERPRETER_OPTIMIZER_HPP
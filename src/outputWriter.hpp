@@ -0,0 +1,116 @@
+#ifndef PYTHON_INTERPRETER_OUTPUTWRITER_HPP
+#define PYTHON_INTERPRETER_OUTPUTWRITER_HPP
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <unistd.h>
+using namespace std;
+
+// Buffered stdout for print: values are formatted straight into a 64 KiB buffer that goes out with write(2)
+// when it fills, at exit, before the process dies of a signal or std::terminate, and on flush().
+// With lineBuffered set every line goes out as it ends, as endl did.
+class OutputWriter {
+private:
+    static constexpr size_t capacity = 1 << 16;
+    char buffer[capacity];
+    size_t used;
+
+    static void writeAll(const char *s, size_t n) { // async-signal-safe
+        while(n) {
+            const ssize_t k = ::write(1, s, n);
+            if(k < 0) {
+                if(errno == EINTR) continue;
+                return;
+            }
+            s += k, n -= k;
+        }
+    }
+
+    static void onSignal(int sig) {
+        instance().flush();
+        signal(sig, SIG_DFL);
+        raise(sig);
+    }
+
+    static void onTerminate() { // says why, as the default handler would
+        instance().flush();
+        if(auto e = current_exception()) {
+            try {
+                rethrow_exception(e);
+            } catch(const exception &x) {
+                fprintf(stderr, "terminate called after throwing an exception\n  what():  %s\n", x.what());
+            } catch(...) {}
+        }
+        abort();
+    }
+
+public:
+    bool lineBuffered;
+
+    OutputWriter(): used(0), lineBuffered(0) {}
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator = (const OutputWriter&) = delete;
+    ~OutputWriter() {
+        flush();
+    }
+
+    static OutputWriter& instance() {
+        static OutputWriter writer;
+        return writer;
+    }
+
+    // flush before dying: crashes on a stack overflow need the alternate stack to run the handler at all.
+    void install() {
+        static char altStack[1 << 16];
+        stack_t ss;
+        ss.ss_sp = altStack, ss.ss_size = sizeof altStack, ss.ss_flags = 0;
+        sigaltstack(&ss, nullptr);
+        struct sigaction sa;
+        memset(&sa, 0, sizeof sa);
+        sa.sa_handler = onSignal, sa.sa_flags = SA_ONSTACK;
+        sigemptyset(&sa.sa_mask);
+        for(int sig: {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT, SIGINT, SIGTERM, SIGPIPE}) sigaction(sig, &sa, nullptr);
+        set_terminate(onTerminate);
+    }
+
+    void flush() {
+        const size_t n = used;
+        used = 0;
+        writeAll(buffer, n);
+    }
+
+    // room for n bytes, to be filled and then committed; nullptr if n will never fit.
+    char* reserve(size_t n) {
+        if(n > capacity) return nullptr;
+        if(capacity - used < n) flush();
+        return buffer + used;
+    }
+    void commit(size_t n) {
+        used += n;
+    }
+
+    void write(const char *s, size_t n) {
+        if(capacity - used < n) {
+            flush();
+            if(n >= capacity) return writeAll(s, n);
+        }
+        memcpy(buffer + used, s, n), used += n;
+    }
+    void write(const string &s) {
+        write(s.data(), s.length());
+    }
+    void put(char c) {
+        if(used == capacity) flush();
+        buffer[used++] = c;
+    }
+    void endLine() {
+        put('\n');
+        if(lineBuffered) flush();
+    }
+};
+
+#endif //PYTHON_INTERPRETER_OUTPUTWRITER_HPP
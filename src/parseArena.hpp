@@ -0,0 +1,71 @@
+#ifndef PYTHON_INTERPRETER_PARSEARENA_HPP
+#define PYTHON_INTERPRETER_PARSEARENA_HPP
+
+#include "antlr4-runtime.h"
+#include "compactTokens.hpp"
+#include <new>
+#include <type_traits>
+#include <vector>
+using namespace std;
+
+// Memory for one parse: the nodes of a tree, and the tokens too when the lexer is given the arena, placed one
+// after another in 64 KiB chunks that go back to the heap together when the arena goes. The parsers and passes
+// take it where ANTLR takes a ParseTreeTracker; like a Parser's tracker it destroys the nodes it made. Tokens are
+// rows of its TokenTable behind CompactToken handles, which the stream holding them deletes, leaving the memory
+// here. So an arena must outlive the token streams and trees that use it. Nodes made through a plain
+// ParseTreeTracker come from the heap, as before.
+class ParseArena: public antlr4::tree::ParseTreeTracker {
+public:
+    static constexpr size_t alignment = 16, chunkBytes = 64 << 10;
+    size_t nodeCount, bytes; // for --parse-stats
+    TokenTable tokens;
+
+private:
+    vector<char*> chunks;
+    char *at, *end;
+    vector<antlr4::tree::ParseTree*> nodes;
+
+public:
+    ParseArena(): nodeCount(0), bytes(0), at(nullptr), end(nullptr) {}
+    ParseArena(const ParseArena&) = delete;
+    ParseArena& operator = (const ParseArena&) = delete;
+    ~ParseArena() {
+        reset();
+        for(auto c: chunks) ::operator delete(c);
+    }
+
+    void* allocate(size_t n, size_t align = alignment) {
+        n = (n + align - 1) / align * align, bytes += n;
+        if(n > chunkBytes / 4) {
+            chunks.push_back((char*) ::operator new(n));
+            return chunks.back();
+        }
+        at = end - (size_t) (end - at) / align * align; // chunks are aligned for anything, so this rounds at up
+        if((size_t) (end - at) < n) chunks.push_back(at = (char*) ::operator new(chunkBytes)), end = at + chunkBytes;
+        void *ret = at;
+        at += n;
+        return ret;
+    }
+
+    template<typename T, typename ... Args>
+    T* createInstance(Args&& ... args) {
+        static_assert(is_base_of<antlr4::tree::ParseTree, T>::value, "Argument must be a parse tree type");
+        T *ret = new(allocate(sizeof(T))) T(args...);
+        nodes.push_back(ret), nodeCount++;
+        return ret;
+    }
+
+    // a new row of tokens and its handle.
+    CompactToken* token(size_t type, size_t start, size_t stop, size_t line, size_t column) {
+        return new(allocate(sizeof(CompactToken), alignof(CompactToken))) CompactToken(&tokens, tokens.add(type, start, stop, line, column));
+    }
+
+    // destroys the nodes; their memory waits for the arena to go.
+    void reset() {
+        for(auto i: nodes) i->~ParseTree();
+        nodes.clear();
+        ParseTreeTracker::reset();
+    }
+};
+
+#endif //PYTHON_INTERPRETER_PARSEARENA_HPP
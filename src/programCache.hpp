@@ -0,0 +1,274 @@
+#ifndef PYTHON_INTERPRETER_PROGRAMCACHE_HPP
+#define PYTHON_INTERPRETER_PROGRAMCACHE_HPP
+
+#include "antlr4-runtime.h"
+#include "Python3Parser.h"
+#include "cacheFile.hpp"
+#include "parseArena.hpp"
+#include "syntheticNodes.hpp"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// --program-cache: the tree of a program as the optimizer passes left it, saved under a hash of its source so
+// the next run on the same bytes rebuilds it from the file instead of lexing, parsing and optimizing. A file holds
+// the tokens the tree refers to (type, position; their text stays in the source) and the tree in preorder, synthetic
+// nodes included, behind a header with the format, the interpreter build that wrote it and a checksum of the rest.
+// A file is ignored unless everything in it checks out.
+class ProgramCache {
+private:
+    typedef Python3Parser P;
+    typedef antlr4::ParserRuleContext* (*Factory)(antlr4::ParserRuleContext*, size_t, ParseArena&);
+    static constexpr uint64_t magic = 0x0200454552545950ULL; // "PYTREE", format 2
+    enum {atomTag = P::RuleArgument + 2, loopTag, appendTag}; // after the rules' tags: the synthetic nodes
+
+    string path;
+    uint64_t sourceHash, sourceSize;
+    vector<unique_ptr<antlr4::Token> > tokens; // what a loaded tree refers to
+    uint64_t numbered; // nodes written so far
+    unordered_map<antlr4::tree::ParseTree*, uint64_t> written; // preorder numbers of the nodes synthetic ones may point to
+    vector<antlr4::tree::ParseTree*> read;
+
+    static const char* buildStamp() {
+        return __DATE__ " " __TIME__;
+    }
+
+    template<class T> static antlr4::ParserRuleContext* make(antlr4::ParserRuleContext *parent, size_t invokingState,
+                                                             ParseArena &tracker) {
+        return tracker.createInstance<T>(parent, invokingState);
+    }
+    static Factory factory(size_t rule) { // in Python3Parser's rule order
+        static const Factory ret[] = {
+            make<P::File_inputContext>, make<P::FuncdefContext>, make<P::ParametersContext>, make<P::TypedargslistContext>,
+            make<P::TfpdefContext>, make<P::StmtContext>, make<P::Simple_stmtContext>, make<P::Small_stmtContext>,
+            make<P::Expr_stmtContext>, make<P::AugassignContext>, make<P::Flow_stmtContext>, make<P::Break_stmtContext>,
+            make<P::Continue_stmtContext>, make<P::Return_stmtContext>, make<P::Compound_stmtContext>, make<P::If_stmtContext>,
+            make<P::While_stmtContext>, make<P::SuiteContext>, make<P::TestContext>, make<P::Or_testContext>,
+            make<P::And_testContext>, make<P::Not_testContext>, make<P::ComparisonContext>, make<P::Comp_opContext>,
+            make<P::Arith_exprContext>, make<P::TermContext>, make<P::FactorContext>, make<P::Addsub_opContext>,
+            make<P::Muls_opContext>, make<P::Atom_exprContext>, make<P::TrailerContext>, make<P::AtomContext>,
+            make<P::TestlistContext>, make<P::ArglistContext>, make<P::ArgumentContext>};
+        static_assert(sizeof ret / sizeof *ret == P::RuleArgument + 1, "one factory per rule");
+        return rule < sizeof ret / sizeof *ret ? ret[rule] : nullptr;
+    }
+
+    static uint64_t zigzag(int64_t x) {
+        return (uint64_t) x << 1 ^ (uint64_t) (x >> 63);
+    }
+    static int64_t unzigzag(uint64_t x) {
+        return (int64_t) (x >> 1 ^ -(x & 1));
+    }
+    static size_t indexOf(antlr4::Token *t) {
+        return t ? t->getTokenIndex() : 0;
+    }
+    // a token as its index relative to base, which is usually close by; 0 for no token.
+    static uint64_t relative(antlr4::Token *t, size_t base, size_t count) {
+        return t && t->getTokenIndex() < count ? zigzag((int64_t) t->getTokenIndex() - (int64_t) base) + 1 : 0;
+    }
+    antlr4::Token* token(uint64_t id, size_t base, CacheReader &r) {
+        if(!id) return nullptr;
+        const size_t at = base + unzigzag(id - 1);
+        if(at >= tokens.size()) return r.ok = 0, nullptr;
+        return tokens[at].get();
+    }
+
+    static uint64_t tagOf(antlr4::ParserRuleContext *ctx) {
+        switch(ctx->getRuleIndex()) {
+            case P::RuleAtom: if(isSynthetic(static_cast<P::AtomContext*>(ctx))) return atomTag; break;
+            case P::RuleWhile_stmt: if(dynamic_cast<PlannedLoop*>(ctx)) return loopTag; break;
+            case P::RuleExpr_stmt: if(dynamic_cast<AppendStmt*>(ctx)) return appendTag; break;
+        }
+        return ctx->getRuleIndex() + 1;
+    }
+
+    static void writeValue(CacheWriter &w, const DataType &x) {
+        w.u8(x.tpe);
+        if(x.tpe == Bool) w.u8(x.data_Bool);
+        else if(x.tpe == Int) {
+            const bool neg = x.data_Int.negative(); // the digits may be anything int() was given, '-' included
+            w.u8(neg), w.str(x.data_Int.toString().substr(neg));
+        } else if(x.tpe == Float) {
+            uint64_t bits;
+            memcpy(&bits, &x.data_Float, sizeof bits), w.u64(bits);
+        } else if(x.tpe == String) w.str(x.data_String.str());
+    }
+    static DataType readValue(CacheReader &r) {
+        const uint8_t tpe = r.u8();
+        if(tpe == Bool) return DataType((bool) r.u8());
+        if(tpe == Int) {
+            const bool neg = r.u8();
+            const BigInt digits(r.str());
+            return DataType(neg ? -digits : digits);
+        }
+        if(tpe == Float) {
+            const uint64_t bits = r.u64();
+            double x;
+            memcpy(&x, &bits, sizeof x);
+            return DataType(x);
+        }
+        if(tpe == String) return DataType(r.str());
+        if(tpe != None) r.ok = 0;
+        return DataType(None);
+    }
+
+    // a node a synthetic one points to, as its preorder number + 1; 0 for none.
+    uint64_t reference(antlr4::tree::ParseTree *node) {
+        const auto it = written.find(node);
+        return it == written.end() ? 0 : it->second + 1;
+    }
+    template<class T> T* resolve(uint64_t id, CacheReader &r) {
+        if(!id) return nullptr;
+        T *ret = id <= read.size() ? dynamic_cast<T*>(read[id - 1]) : nullptr;
+        if(!ret) r.ok = 0;
+        return ret;
+    }
+
+    // a terminal is 0 and its token; a rule node is its tag (rule + 1, or a synthetic node's), invokingState + 1,
+    // the number of children, its start and stop tokens, the children, and what a synthetic node adds: an atom's
+    // kind, value, loop and the subtree it stands for; a loop's counter, condition, step statement and stride;
+    // an append's target and operand, which point back to nodes already written. A node met twice is written twice
+    // (ConstantFolder reuses an if's keyword and colon for its else branch, which only the printers read).
+    bool writeNode(CacheWriter &w, antlr4::tree::ParseTree *node, size_t base, size_t count) {
+        const uint64_t number = numbered++;
+        auto ctx = dynamic_cast<antlr4::ParserRuleContext*>(node);
+        if(!ctx) {
+            const uint64_t id = relative(static_cast<antlr4::tree::TerminalNode*>(node)->getSymbol(), base, count);
+            return w.varint(0), w.varint(id), id != 0;
+        }
+        const size_t start = indexOf(ctx->start);
+        const uint64_t tag = tagOf(ctx);
+        if(tag == loopTag || tag == P::RuleComparison + 1 || tag == P::RuleStmt + 1 || tag == P::RuleTerm + 1) written.emplace(node, number);
+        w.varint(tag), w.varint(ctx->invokingState + 1), w.varint(ctx->children.size());
+        w.varint(relative(ctx->start, base, count)), w.varint(relative(ctx->stop, start, count));
+        for(auto child: ctx->children) if(!writeNode(w, child, start, count)) return 0;
+        if(tag == atomTag) {
+            const auto atom = static_cast<SyntheticAtom*>(ctx);
+            const uint64_t loop = reference(atom->loop);
+            w.varint(atom->kind);
+            writeValue(w, atom->kind == Constant ? atom->value : DataType(None)); // a Hoisted value is per run
+            w.varint(loop);
+            return atom->origin && !loop == !atom->loop && writeNode(w, atom->origin, start, count);
+        }
+        if(tag == loopTag) {
+            const auto loop = static_cast<PlannedLoop*>(ctx);
+            const uint64_t cond = reference(loop->cond), step = reference(loop->step);
+            w.str(loop->counter), w.varint(cond), w.varint(step), w.varint(zigzag(loop->stride));
+            return !cond == !loop->cond && !step == !loop->step;
+        }
+        if(tag == appendTag) {
+            const auto append = static_cast<AppendStmt*>(ctx);
+            const uint64_t operand = reference(append->operand);
+            w.str(symbols.name(append->target)), w.varint(operand);
+            return operand != 0;
+        }
+        return 1;
+    }
+    antlr4::tree::ParseTree* readNode(CacheReader &r, antlr4::ParserRuleContext *parent, size_t base, ParseArena &tracker) {
+        const uint64_t tag = r.varint();
+        if(!tag) {
+            antlr4::Token *t = token(r.varint(), base, r);
+            if(!t || !parent) return r.ok = 0, nullptr;
+            read.push_back(parent->addChild(tracker.createInstance<antlr4::tree::TerminalNodeImpl>(t)));
+            return read.back();
+        }
+        const size_t invokingState = r.varint() - 1;
+        const uint64_t children = r.varint();
+        antlr4::ParserRuleContext *ctx;
+        if(tag == atomTag) ctx = tracker.createInstance<SyntheticAtom>(Constant, nullptr);
+        else if(tag == loopTag) ctx = tracker.createInstance<PlannedLoop>();
+        else if(tag == appendTag) ctx = tracker.createInstance<AppendStmt>(-1, nullptr);
+        else if(const Factory create = factory(tag - 1)) ctx = create(parent, invokingState, tracker);
+        else return r.ok = 0, nullptr;
+        if(!r.ok) return nullptr;
+        read.push_back(ctx);
+        ctx->parent = parent;
+        ctx->start = token(r.varint(), base, r);
+        const size_t start = indexOf(ctx->start);
+        ctx->stop = token(r.varint(), start, r);
+        if(parent) parent->addChild(ctx);
+        for(uint64_t i = 0; i < children && r.ok; i++) readNode(r, ctx, start, tracker);
+        if(tag == atomTag) {
+            const auto atom = static_cast<SyntheticAtom*>(ctx);
+            const uint64_t kind = r.varint();
+            atom->kind = (SyntheticKind) kind, atom->value = readValue(r);
+            atom->loop = resolve<PlannedLoop>(r.varint(), r);
+            atom->origin = dynamic_cast<antlr4::ParserRuleContext*>(readNode(r, atom, start, tracker));
+            atom->children.clear(); // the origin was read below the atom, but atoms made by the passes have no children
+            if(kind > Hoisted || !atom->origin || (kind == Hoisted) != !!atom->loop) r.ok = 0;
+        } else if(tag == loopTag) {
+            const auto loop = static_cast<PlannedLoop*>(ctx);
+            loop->counter = r.str(), loop->cond = resolve<P::ComparisonContext>(r.varint(), r);
+            loop->step = resolve<P::StmtContext>(r.varint(), r), loop->stride = unzigzag(r.varint());
+        } else if(tag == appendTag) {
+            const auto append = static_cast<AppendStmt*>(ctx);
+            append->target = symbols.intern(r.str()), append->operand = resolve<P::TermContext>(r.varint(), r);
+            if(!append->operand) r.ok = 0;
+        }
+        return ctx;
+    }
+
+public:
+    // dir: where cache files go, one per distinct source.
+    ProgramCache(const string &dir, const char *source, size_t size): sourceHash(fnv1a(source, size)), sourceSize(size) {
+        char name[24];
+        snprintf(name, sizeof name, "%016llx.tree", (unsigned long long) sourceHash);
+        path = (dir.empty() ? "." : dir) + "/" + name;
+    }
+
+    const string& file() const {
+        return path;
+    }
+
+    // the cached tree, its nodes and tokens allocated from tracker and the tokens pointing into input; nullptr on a miss.
+    antlr4::tree::ParseTree* load(antlr4::TokenSource *lexer, Utf8CharStream *input, ParseArena &tracker) {
+        string data;
+        if(tracker.tokens.size()) return nullptr; // token indexes are rows of its table
+        if(!readCacheFile(path, data)) return nullptr;
+        CacheReader header(data);
+        if(header.u64() != magic || header.str() != buildStamp() || header.u64() != sourceSize || header.u64() != sourceHash) return nullptr;
+        const uint64_t sum = header.u64();
+        const string body = header.str();
+        if(!header.ok || !header.done() || fnv1a(body.data(), body.size()) != sum) return nullptr;
+        CacheReader r(body);
+        const uint64_t count = r.varint();
+        if(count > body.size()) return nullptr; // at least a byte a token
+        tokens.clear(), tracker.tokens.bind(lexer, input);
+        int64_t next = 0, line = 0;
+        for(uint64_t i = 0; i < count && r.ok; i++) {
+            const size_t type = r.varint();
+            const int64_t start = next + unzigzag(r.varint()), stop = start + unzigzag(r.varint());
+            line += unzigzag(r.varint());
+            const size_t column = r.varint();
+            tokens.emplace_back(tracker.token(type, start, stop, line, column));
+            next = stop + 1;
+        }
+        // a bad file may have left part of a tree in tracker; it is freed with the others.
+        read.clear();
+        antlr4::tree::ParseTree *ret = r.ok ? readNode(r, nullptr, 0, tracker) : nullptr;
+        if(!r.ok || !r.done() || !dynamic_cast<P::File_inputContext*>(ret)) return tokens.clear(), tracker.tokens.clear(), nullptr;
+        return ret;
+    }
+
+    // saves the optimized tree of a program without syntax errors; streamTokens: the tokens it was parsed from.
+    bool store(antlr4::tree::ParseTree *tree, const vector<antlr4::Token*> &streamTokens) {
+        CacheWriter w;
+        w.varint(streamTokens.size());
+        int64_t next = 0, line = 0;
+        for(auto t: streamTokens) { // positions as differences from the previous token's
+            const int64_t start = t->getStartIndex(), stop = t->getStopIndex();
+            w.varint(t->getType()), w.varint(zigzag(start - next)), w.varint(zigzag(stop - start));
+            w.varint(zigzag((int64_t) t->getLine() - line)), w.varint(t->getCharPositionInLine());
+            next = stop + 1, line = t->getLine();
+        }
+        numbered = 0, written.clear();
+        if(!writeNode(w, tree, 0, streamTokens.size())) return 0;
+        CacheWriter file;
+        file.u64(magic), file.str(buildStamp()), file.u64(sourceSize), file.u64(sourceHash);
+        file.u64(fnv1a(w.out.data(), w.out.size())), file.str(w.out);
+        return writeCacheFile(path, file.out);
+    }
+};
+
+#endif //PYTHON_INTERPRETER_PROGRAMCACHE_HPP
@@ -0,0 +1,117 @@
+#ifndef PYTHON_INTERPRETER_PROGRAMPRINTER_HPP
+#define PYTHON_INTERPRETER_PROGRAMPRINTER_HPP
+
+#include "syntheticNodes.hpp"
+#include <cstdlib>
+
+// Prints a (possibly rewritten) parse tree back as source, one statement per line.
+// Constant atoms print their folded value; other synthetic atoms print the expression they stand for.
+class ProgramPrinter {
+private:
+    ostream &os;
+
+    static string literal(const DataType &x) {
+        if(x.tpe == Float) {
+            char buf[64];
+            for(int precision = 15; precision <= 17; precision++) { // shortest form that reads back exactly
+                snprintf(buf, sizeof buf, "%.*g", precision, x.data_Float);
+                if(strtod(buf, nullptr) == x.data_Float) break;
+            }
+            string ret = buf;
+            if(ret.find_first_of(".en") == string::npos) ret += ".0";
+            return ret;
+        }
+        if(x.tpe == String) {
+            const string text = x.data_String.str();
+            const char quote = text.find('"') == string::npos || text.find('\'') != string::npos ? '"' : '\'';
+            return quote + text + quote;
+        }
+        return x.toPrint();
+    }
+
+    void indent(int depth) {
+        for(int i = 0; i < depth; i++) os << "    ";
+    }
+
+    void suite(Python3Parser::SuiteContext *ctx, int depth) {
+        os << ":" << endl;
+        if(ctx->simple_stmt()) {
+            indent(depth + 1), os << expr(ctx->simple_stmt()->small_stmt()) << endl;
+            return;
+        }
+        const auto ls = ctx->stmt();
+        if(ls.empty()) indent(depth + 1), os << "None # every statement here was eliminated" << endl;
+        for(auto t: ls) stmt(t, depth + 1);
+    }
+
+public:
+    explicit ProgramPrinter(ostream &_os): os(_os) {}
+
+    string expr(antlr4::tree::ParseTree *node) {
+        if(auto terminal = dynamic_cast<antlr4::tree::TerminalNode*>(node)) return terminal->getText();
+        const auto ctx = static_cast<antlr4::ParserRuleContext*>(node);
+        switch(ctx->getRuleIndex()) {
+            case Python3Parser::RuleAtom: {
+                const auto atom = static_cast<Python3Parser::AtomContext*>(ctx);
+                if(isSynthetic(atom)) {
+                    const auto synthetic = static_cast<SyntheticAtom*>(atom);
+                    return synthetic->kind == Constant ? literal(synthetic->value) : expr(synthetic->origin);
+                }
+                if(atom->test()) return "(" + expr(atom->test()) + ")";
+                break;
+            }
+            case Python3Parser::RuleFactor: case Python3Parser::RuleAtom_expr: case Python3Parser::RuleTrailer:
+            case Python3Parser::RuleParameters: case Python3Parser::RuleArgument: {
+                string ret; // tight: -x, f(a, b=1)
+                for(auto t: ctx->children) ret += expr(t);
+                return ret;
+            }
+            case Python3Parser::RuleArglist: case Python3Parser::RuleTestlist: case Python3Parser::RuleTypedargslist: {
+                string ret;
+                for(auto t: ctx->children) ret += t->getText() == "," ? ", " : expr(t);
+                return ret;
+            }
+            default: break;
+        }
+        string ret;
+        for(auto t: ctx->children) {
+            const string sub = expr(t);
+            if(sub.empty()) continue;
+            if(!ret.empty()) ret += " ";
+            ret += sub;
+        }
+        return ret;
+    }
+
+    void stmt(Python3Parser::StmtContext *ctx, int depth) {
+        if(ctx->simple_stmt()) {
+            indent(depth), os << expr(ctx->simple_stmt()->small_stmt()) << endl;
+            return;
+        }
+        const auto compound = ctx->compound_stmt();
+        if(const auto def = compound->funcdef()) {
+            indent(depth), os << "def " << def->NAME()->getText() << expr(def->parameters());
+            suite(def->suite(), depth);
+        } else if(const auto loop = compound->while_stmt()) {
+            indent(depth), os << "while " << expr(loop->test());
+            suite(loop->suite(), depth);
+        } else {
+            const auto branch = compound->if_stmt();
+            const auto ls_test = branch->test();
+            const auto ls_suite = branch->suite();
+            for(unsigned i = 0; i < ls_suite.size(); i++) {
+                indent(depth);
+                if(i < ls_test.size()) os << (i ? "elif " : "if ") << expr(ls_test[i]);
+                else os << "else";
+                suite(ls_suite[i], depth);
+            }
+        }
+    }
+
+    void program(antlr4::tree::ParseTree *tree) {
+        for(auto t: tree->children)
+            if(auto s = dynamic_cast<Python3Parser::StmtContext*>(t)) stmt(s, 0);
+    }
+};
+
+#endif //PYTHON_INTERPRETER_PROGRAMPRINTER_HPP
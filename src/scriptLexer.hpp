@@ -0,0 +1,324 @@
+#ifndef PYTHON_INTERPRETER_SCRIPTLEXER_HPP
+#define PYTHON_INTERPRETER_SCRIPTLEXER_HPP
+
+#include "antlr4-runtime.h"
+#include "Python3Parser.h"
+#include "identifierTables.hpp"
+#include "parseArena.hpp"
+#include "sourceStream.hpp"
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// Hand-written replacement for the ANTLR-generated Python3Lexer. It gives the same tokens, down to start/stop
+// index, line and column: longest match with ties going to the earlier rule of Python3.g4, and the NEWLINE
+// action's INDENT/DEDENT bookkeeping, including its quirks (NEWLINE and INDENT tokens are placed at the end
+// of the text they were matched from, a DEDENT takes the line of the last token of the previous match, and
+// a file that ends inside a block without a line break gets NEWLINE, DEDENTs and EOF appended).
+// --check-lexer compares the two on a program.
+class ScriptLexer: public antlr4::TokenSource {
+private:
+    Utf8CharStream &input;
+    const unsigned char *s;
+    size_t n;
+    size_t at, index, line, col; // next byte, its code point index, and its position as ANTLR counts it
+    deque<unique_ptr<antlr4::Token> > pending;
+    vector<int> indents;
+    int opened; // open brackets: line breaks inside them are not NEWLINEs
+    size_t lastLine;
+    bool done;
+    ParseArena *arena; // whose token table tokens go to, if not to CommonTokens on the heap
+
+    int byteAt(size_t pos) const {
+        return pos < n ? s[pos] : -1;
+    }
+    size_t skip(size_t pos) const { // offset of the code point after the one at pos
+        return pos + input.codePointLength(pos);
+    }
+    static bool isDigit(int c) {
+        return c >= '0' && c <= '9';
+    }
+    static bool isLineBreak(int c) {
+        return c == '\r' || c == '\n' || c == '\f';
+    }
+    size_t spacesEnd(size_t pos) const {
+        while(byteAt(pos) == ' ' || byteAt(pos) == '\t') pos++;
+        return pos;
+    }
+    size_t lineBreakEnd(size_t pos) const { // '\r'? '\n' | '\r' | '\f'
+        if(byteAt(pos) == '\r') return byteAt(pos + 1) == '\n' ? pos + 2 : pos + 1;
+        return byteAt(pos) == '\n' || byteAt(pos) == '\f' ? pos + 1 : pos;
+    }
+    size_t digitsEnd(size_t pos) const {
+        while(isDigit(byteAt(pos))) pos++;
+        return pos;
+    }
+
+    void advance(size_t to) {
+        while(at < to) {
+            if(s[at] == '\n') line++, col = 0;
+            else col++;
+            at = skip(at), index++;
+        }
+    }
+
+    unique_ptr<antlr4::Token> token(size_t type, size_t start, size_t stop, size_t tokenLine, size_t tokenCol) {
+        if(arena) return unique_ptr<antlr4::Token>(arena->token(type, start, stop, tokenLine, tokenCol));
+        unique_ptr<antlr4::CommonToken> ret(new antlr4::CommonToken(make_pair(this, &input), type, antlr4::Token::DEFAULT_CHANNEL, start, stop));
+        ret->setLine(tokenLine), ret->setCharPositionInLine(tokenCol);
+        return ret;
+    }
+    // what Python3Lexer::commonToken makes: a token ending where the lexer stands, textLength chars long.
+    void emitHere(size_t type, int textLength, size_t tokenLine) {
+        const int stop = (int) index - 1, start = textLength ? stop - textLength + 1 : stop;
+        pending.push_back(token(type, start, stop, tokenLine, col));
+    }
+
+    // end of the literal whose opening quote is at q, or 0.
+    size_t stringEnd(size_t q, bool isBytes) const {
+        const int quote = s[q];
+        if(byteAt(q + 1) == quote && byteAt(q + 2) == quote) { // the first closing triple quote ends it
+            for(size_t p = q + 3; p < n; ) {
+                const int c = s[p];
+                if(c == quote && byteAt(p + 1) == quote && byteAt(p + 2) == quote) return p + 3;
+                if(isBytes && c >= 0x80) break;
+                if(c == '\\') {
+                    if(p + 1 >= n || (isBytes && s[p + 1] >= 0x80)) break;
+                    p = skip(p + 1);
+                } else p = skip(p);
+            }
+        }
+        for(size_t p = q + 1; p < n; ) { // else '' of it may still be a short string
+            const int c = s[p];
+            if(c == quote) return p + 1;
+            if(c == '\r' || c == '\n' || (!isBytes && c == '\f') || (isBytes && c >= 0x80)) return 0;
+            if(c == '\\') {
+                if(p + 1 >= n || (isBytes && s[p + 1] >= 0x80)) return 0;
+                p = !isBytes && s[p + 1] == '\r' && byteAt(p + 2) == '\n' ? p + 3 : skip(p + 1);
+            } else p = skip(p);
+        }
+        return 0;
+    }
+    // a string with a prefix (r, u, f, fr, rf, b, br, rb in any case) starting at pos, or 0.
+    size_t prefixedStringEnd(size_t pos) const {
+        const int a = s[pos] | 0x20, b = byteAt(pos + 1) | 0x20, q1 = byteAt(pos + 1), q2 = byteAt(pos + 2);
+        if((q1 == '\'' || q1 == '"') && (a == 'r' || a == 'u' || a == 'f' || a == 'b')) return stringEnd(pos + 1, a == 'b');
+        if((q2 == '\'' || q2 == '"') && ((a == 'f' && b == 'r') || (a == 'r' && b == 'f') || (a == 'b' && b == 'r') || (a == 'r' && b == 'b')))
+            return stringEnd(pos + 2, a == 'b' || b == 'b');
+        return 0;
+    }
+
+    // the longest of DECIMAL/OCT/HEX/BIN_INTEGER, FLOAT_NUMBER and IMAG_NUMBER at pos.
+    size_t numberEnd(size_t pos) const {
+        size_t best = 0;
+        const size_t intEnd = digitsEnd(pos);
+        const bool hasInt = intEnd > pos;
+        if(s[pos] == '0') {
+            for(best = pos; byteAt(best) == '0'; best++);
+            const int radix = byteAt(pos + 1) | 0x20;
+            size_t p = pos + 2;
+            if(radix == 'o') while(byteAt(p) >= '0' && byteAt(p) <= '7') p++;
+            else if(radix == 'x') while(isDigit(byteAt(p)) || ((byteAt(p) | 0x20) >= 'a' && (byteAt(p) | 0x20) <= 'f')) p++;
+            else if(radix == 'b') while(byteAt(p) == '0' || byteAt(p) == '1') p++;
+            if(p > pos + 2) best = max(best, p);
+        } else if(hasInt) best = intEnd;
+        size_t floatEnd = 0;
+        if(byteAt(intEnd) == '.') {
+            const size_t fracEnd = digitsEnd(intEnd + 1);
+            if(fracEnd > intEnd + 1) floatEnd = fracEnd;
+            else if(hasInt) floatEnd = intEnd + 1;
+        }
+        const size_t base = floatEnd ? floatEnd : hasInt ? intEnd : 0;
+        if(base && (byteAt(base) | 0x20) == 'e') {
+            size_t p = base + 1;
+            if(byteAt(p) == '+' || byteAt(p) == '-') p++;
+            if(digitsEnd(p) > p) floatEnd = digitsEnd(p);
+        }
+        best = max(best, floatEnd);
+        if(floatEnd && (byteAt(floatEnd) | 0x20) == 'j') best = max(best, floatEnd + 1);
+        if(hasInt && (byteAt(intEnd) | 0x20) == 'j') best = max(best, intEnd + 1);
+        return best;
+    }
+
+    size_t keyword(size_t from, size_t to) const {
+        static const pair<const char*, size_t> keywords[] = {
+            {"def", Python3Parser::DEF}, {"return", Python3Parser::RETURN}, {"if", Python3Parser::IF},
+            {"elif", Python3Parser::ELIF}, {"else", Python3Parser::ELSE}, {"while", Python3Parser::WHILE},
+            {"for", Python3Parser::FOR}, {"in", Python3Parser::IN}, {"or", Python3Parser::OR},
+            {"and", Python3Parser::AND}, {"not", Python3Parser::NOT}, {"None", Python3Parser::NONE},
+            {"True", Python3Parser::TRUE}, {"False", Python3Parser::FALSE}, {"continue", Python3Parser::CONTINUE},
+            {"break", Python3Parser::BREAK}
+        };
+        for(auto &t: keywords)
+            if(strlen(t.first) == to - from && !memcmp(t.first, s + from, to - from)) return t.second;
+        return Python3Parser::NAME;
+    }
+
+    size_t operatorAt(size_t pos, size_t &end) {
+        const int c = s[pos], c1 = byteAt(pos + 1), c2 = byteAt(pos + 2);
+        end = pos + 1;
+        switch(c) {
+            case '.': return c1 == '.' && c2 == '.' ? (end += 2, Python3Parser::ELLIPSIS) : Python3Parser::DOT;
+            case '*':
+                if(c1 == '*') return c2 == '=' ? (end += 2, Python3Parser::POWER_ASSIGN) : (end++, Python3Parser::POWER);
+                return c1 == '=' ? (end++, Python3Parser::MULT_ASSIGN) : Python3Parser::STAR;
+            case '(': return ++opened, Python3Parser::OPEN_PAREN;
+            case ')': return --opened, Python3Parser::CLOSE_PAREN;
+            case '[': return ++opened, Python3Parser::OPEN_BRACK;
+            case ']': return --opened, Python3Parser::CLOSE_BRACK;
+            case '{': return ++opened, Python3Parser::OPEN_BRACE;
+            case '}': return --opened, Python3Parser::CLOSE_BRACE;
+            case ',': return Python3Parser::COMMA;
+            case ':': return Python3Parser::COLON;
+            case ';': return Python3Parser::SEMI_COLON;
+            case '~': return Python3Parser::NOT_OP;
+            case '=': return c1 == '=' ? (end++, Python3Parser::EQUALS) : Python3Parser::ASSIGN;
+            case '|': return c1 == '=' ? (end++, Python3Parser::OR_ASSIGN) : Python3Parser::OR_OP;
+            case '^': return c1 == '=' ? (end++, Python3Parser::XOR_ASSIGN) : Python3Parser::XOR;
+            case '&': return c1 == '=' ? (end++, Python3Parser::AND_ASSIGN) : Python3Parser::AND_OP;
+            case '+': return c1 == '=' ? (end++, Python3Parser::ADD_ASSIGN) : Python3Parser::ADD;
+            case '%': return c1 == '=' ? (end++, Python3Parser::MOD_ASSIGN) : Python3Parser::MOD;
+            case '@': return c1 == '=' ? (end++, Python3Parser::AT_ASSIGN) : Python3Parser::AT;
+            case '!': return c1 == '=' ? (end++, Python3Parser::NOT_EQ_2) : Python3Parser::UNKNOWN_CHAR;
+            case '-':
+                if(c1 == '=') return end++, Python3Parser::SUB_ASSIGN;
+                return c1 == '>' ? (end++, Python3Parser::ARROW) : Python3Parser::MINUS;
+            case '/':
+                if(c1 == '/') return c2 == '=' ? (end += 2, Python3Parser::IDIV_ASSIGN) : (end++, Python3Parser::IDIV);
+                return c1 == '=' ? (end++, Python3Parser::DIV_ASSIGN) : Python3Parser::DIV;
+            case '<':
+                if(c1 == '<') return c2 == '=' ? (end += 2, Python3Parser::LEFT_SHIFT_ASSIGN) : (end++, Python3Parser::LEFT_SHIFT);
+                if(c1 == '=') return end++, Python3Parser::LT_EQ;
+                return c1 == '>' ? (end++, Python3Parser::NOT_EQ_1) : Python3Parser::LESS_THAN;
+            case '>':
+                if(c1 == '>') return c2 == '=' ? (end += 2, Python3Parser::RIGHT_SHIFT_ASSIGN) : (end++, Python3Parser::RIGHT_SHIFT);
+                return c1 == '=' ? (end++, Python3Parser::GT_EQ) : Python3Parser::GREATER_THAN;
+            default: return end = skip(pos), Python3Parser::UNKNOWN_CHAR;
+        }
+    }
+
+    // the NEWLINE rule and its action; returns whether a token ended the match.
+    bool newline() {
+        const size_t breakEnd = lineBreakEnd(at), spacesFrom = breakEnd, to = spacesEnd(breakEnd);
+        const int breakLength = breakEnd - at;
+        advance(to);
+        if(opened > 0 || isLineBreak(byteAt(at)) || byteAt(at) == '#') return 0; // blank line or inside brackets
+        emitHere(Python3Parser::NEWLINE, breakLength, line);
+        int indent = 0;
+        for(size_t p = spacesFrom; p < to; p++) indent = s[p] == '\t' ? indent + 8 - indent % 8 : indent + 1;
+        const int previous = indents.empty() ? 0 : indents.back();
+        if(indent == previous) return 0;
+        if(indent > previous) {
+            indents.push_back(indent);
+            emitHere(Python3Parser::INDENT, to - spacesFrom, line);
+        } else while(!indents.empty() && indents.back() > indent) {
+            emitHere(Python3Parser::DEDENT, 0, lastLine);
+            indents.pop_back();
+        }
+        return 1;
+    }
+
+    // one match; returns whether it produced a token that ends a call of Python3Lexer::nextToken.
+    bool match() {
+        const size_t start = index, startLine = line, startCol = col;
+        const int c = s[at];
+        if(isLineBreak(c) || (!index && (c == ' ' || c == '\t'))) return newline();
+        if(c == ' ' || c == '\t') return advance(spacesEnd(at)), 0;
+        if(c == '#') {
+            size_t p = at;
+            while(p < n && !isLineBreak(s[p])) p = skip(p);
+            return advance(p), 0;
+        }
+        if(c == '\\') { // line joining, else an UNKNOWN_CHAR
+            const size_t p = spacesEnd(at + 1);
+            if(lineBreakEnd(p) > p) return advance(lineBreakEnd(p)), 0;
+        }
+        size_t type, end;
+        const size_t cp = input.codePointAt(at);
+        if(isDigit(c) || (c == '.' && isDigit(byteAt(at + 1)))) type = Python3Parser::NUMBER, end = numberEnd(at);
+        else if(c == '\'' || c == '"') {
+            end = stringEnd(at, 0);
+            type = end ? Python3Parser::STRING : Python3Parser::UNKNOWN_CHAR;
+            if(!end) end = at + 1;
+        } else if(isIdentifierStart(cp)) {
+            end = skip(at);
+            while(end < n && isIdentifierContinue(input.codePointAt(end))) end = skip(end);
+            const size_t strEnd = prefixedStringEnd(at);
+            if(strEnd > end) type = Python3Parser::STRING, end = strEnd;
+            else type = keyword(at, end);
+        } else type = operatorAt(at, end);
+        advance(end);
+        pending.push_back(token(type, start, index - 1, startLine, startCol));
+        return 1;
+    }
+
+    void lex() {
+        if(!done && at >= n && !indents.empty()) { // ends inside a block without a line break
+            emitHere(Python3Parser::NEWLINE, 1, line);
+            for(; !indents.empty(); indents.pop_back()) emitHere(Python3Parser::DEDENT, 0, lastLine);
+            emitHere(antlr4::Token::EOF, 5, line);
+            done = 1;
+        }
+        while(!done) {
+            if(at >= n) {
+                pending.push_back(token(antlr4::Token::EOF, index, index - 1, line, col));
+                done = 1;
+            } else if(match()) break;
+        }
+        if(pending.empty()) pending.push_back(token(antlr4::Token::EOF, index, index - 1, line, col));
+        lastLine = pending.back()->getLine();
+    }
+
+public:
+    explicit ScriptLexer(Utf8CharStream &_input): input(_input), s(_input.bytes()), n(_input.byteLength()) {
+        at = index = col = 0, line = 1, opened = 0, lastLine = 0, done = 0, arena = nullptr;
+    }
+
+    // tokens from now on are rows of _arena's token table, which must outlive every stream holding them and
+    // get no tokens from elsewhere.
+    void allocateFrom(ParseArena &_arena) {
+        arena = &_arena, arena->tokens.bind(this, &input);
+    }
+
+    unique_ptr<antlr4::Token> nextToken() override {
+        if(pending.empty()) lex();
+        auto ret = move(pending.front());
+        pending.pop_front();
+        return ret;
+    }
+    size_t getLine() const override {
+        return line;
+    }
+    size_t getCharPositionInLine() override {
+        return col;
+    }
+    antlr4::CharStream* getInputStream() override {
+        return &input;
+    }
+    string getSourceName() override {
+        return input.getSourceName();
+    }
+    Ref<antlr4::TokenFactory<antlr4::CommonToken> > getTokenFactory() override {
+        return antlr4::CommonTokenFactory::DEFAULT;
+    }
+};
+
+// Compares two token sources up to EOF and reports the first difference on os; for --check-lexer.
+inline bool sameTokens(antlr4::TokenSource &a, antlr4::TokenSource &b, ostream &os) {
+    for(size_t cnt = 1; ; cnt++) {
+        const auto x = a.nextToken(), y = b.nextToken();
+        if(x->getType() != y->getType() || x->getStartIndex() != y->getStartIndex() || x->getStopIndex() != y->getStopIndex()
+           || x->getLine() != y->getLine() || x->getCharPositionInLine() != y->getCharPositionInLine()
+           || x->getChannel() != y->getChannel() || x->getText() != y->getText()) {
+            os << "token " << cnt << " differs:\n  " << x->toString() << "\n  " << y->toString() << endl;
+            return 0;
+        }
+        if(x->getType() == antlr4::Token::EOF) {
+            os << cnt << " tokens match" << endl;
+            return 1;
+        }
+    }
+}
+
+#endif //PYTHON_INTERPRETER_SCRIPTLEXER_HPP
@@ -0,0 +1,441 @@
+#ifndef PYTHON_INTERPRETER_SCRIPTPARSER_HPP
+#define PYTHON_INTERPRETER_SCRIPTPARSER_HPP
+
+#include "antlr4-runtime.h"
+#include "Python3Parser.h"
+#include "dfaCache.hpp"
+#include "parseArena.hpp"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Recursive-descent parser for Python3.g4. Every decision in the grammar is settled by the next token, or the
+// next two for `NAME =` in an argument, so no ATN prediction is needed. It builds the same contexts Python3Parser
+// does (rule nodes, terminals, start/stop tokens) so every visitor runs on its tree unchanged; only invokingState,
+// an ATN state number, is not reproduced. On a syntax error it gives up and leaves the error in error, so that the
+// caller can re-parse with Python3Parser for its diagnostics and recovery.
+// Beyond the grammar it takes a subscript as a trailer, `x[i]` or `x[a:b]` with either bound left out, which it
+// puts under the TrailerContext as '[' test? (':' test?)? ']'. Python3Parser rejects those programs.
+class ScriptParser {
+private:
+    typedef Python3Parser P;
+    struct Failed {};
+
+    ParseArena &tracker;
+    vector<antlr4::Token*> tokens; // default channel, ending with EOF
+    size_t p;
+
+    size_t la(size_t k = 1) const {
+        const size_t at = p + k - 1;
+        return tokens[at < tokens.size() ? at : tokens.size() - 1]->getType();
+    }
+    [[noreturn]] void fail(const string &expected) {
+        const auto t = tokens[p];
+        error = "line " + to_string(t->getLine()) + ":" + to_string(t->getCharPositionInLine()) + " expected " + expected
+                + " at " + (t->getType() == antlr4::Token::EOF ? string("<EOF>") : "'" + t->getText() + "'");
+        throw Failed();
+    }
+
+    template<class T> T* enter(antlr4::ParserRuleContext *parent) {
+        T *ctx = tracker.createInstance<T>(parent, 0);
+        ctx->start = tokens[p];
+        parent->addChild(ctx);
+        return ctx;
+    }
+    template<class T> T* leave(T *ctx) {
+        ctx->stop = tokens[p - 1];
+        return ctx;
+    }
+    void match(antlr4::ParserRuleContext *ctx, size_t tpe, const char *expected) {
+        if(la() != tpe) fail(expected);
+        ctx->addChild(tracker.createInstance<antlr4::tree::TerminalNodeImpl>(tokens[p++]));
+    }
+    void matchAny(antlr4::ParserRuleContext *ctx) {
+        ctx->addChild(tracker.createInstance<antlr4::tree::TerminalNodeImpl>(tokens[p++]));
+    }
+
+    static bool startsTest(size_t tpe) {
+        switch(tpe) {
+            case P::NOT: case P::ADD: case P::MINUS: case P::NAME: case P::NUMBER: case P::STRING:
+            case P::NONE: case P::TRUE: case P::FALSE: case P::OPEN_PAREN: return 1;
+            default: return 0;
+        }
+    }
+    static bool isAugassign(size_t tpe) {
+        return tpe == P::ADD_ASSIGN || tpe == P::SUB_ASSIGN || tpe == P::MULT_ASSIGN || tpe == P::DIV_ASSIGN
+               || tpe == P::IDIV_ASSIGN || tpe == P::MOD_ASSIGN;
+    }
+    static bool isCompOp(size_t tpe) {
+        return tpe == P::LESS_THAN || tpe == P::GREATER_THAN || tpe == P::EQUALS || tpe == P::GT_EQ
+               || tpe == P::LT_EQ || tpe == P::NOT_EQ_2;
+    }
+    static bool isMulsOp(size_t tpe) {
+        return tpe == P::STAR || tpe == P::DIV || tpe == P::IDIV || tpe == P::MOD;
+    }
+
+    void funcdef(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::FuncdefContext>(parent);
+        match(ctx, P::DEF, "'def'"), match(ctx, P::NAME, "a name");
+        parameters(ctx);
+        match(ctx, P::COLON, "':'");
+        suite(ctx);
+        leave(ctx);
+    }
+    void parameters(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::ParametersContext>(parent);
+        match(ctx, P::OPEN_PAREN, "'('");
+        if(la() == P::NAME) typedargslist(ctx);
+        match(ctx, P::CLOSE_PAREN, "')'");
+        leave(ctx);
+    }
+    void typedargslist(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::TypedargslistContext>(parent);
+        for(;;) {
+            auto arg = enter<P::TfpdefContext>(ctx);
+            match(arg, P::NAME, "a parameter name");
+            leave(arg);
+            if(la() == P::ASSIGN) matchAny(ctx), test(ctx);
+            if(la() != P::COMMA) break;
+            matchAny(ctx);
+        }
+        leave(ctx);
+    }
+
+    void stmt(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::StmtContext>(parent);
+        const size_t tpe = la();
+        if(tpe == P::IF || tpe == P::WHILE || tpe == P::DEF) {
+            auto compound = enter<P::Compound_stmtContext>(ctx);
+            if(tpe == P::IF) if_stmt(compound);
+            else if(tpe == P::WHILE) while_stmt(compound);
+            else funcdef(compound);
+            leave(compound);
+        }
+        else simple_stmt(ctx);
+        leave(ctx);
+    }
+    void simple_stmt(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::Simple_stmtContext>(parent);
+        auto small = enter<P::Small_stmtContext>(ctx);
+        const size_t tpe = la();
+        if(tpe == P::BREAK || tpe == P::CONTINUE || tpe == P::RETURN) flow_stmt(small);
+        else expr_stmt(small);
+        leave(small);
+        match(ctx, P::NEWLINE, "end of line");
+        leave(ctx);
+    }
+    void expr_stmt(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::Expr_stmtContext>(parent);
+        testlist(ctx);
+        if(isAugassign(la())) {
+            auto op = enter<P::AugassignContext>(ctx);
+            matchAny(op);
+            leave(op);
+            testlist(ctx);
+        }
+        else while(la() == P::ASSIGN) matchAny(ctx), testlist(ctx);
+        leave(ctx);
+    }
+    void flow_stmt(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::Flow_stmtContext>(parent);
+        const size_t tpe = la();
+        antlr4::ParserRuleContext *flow;
+        if(tpe == P::BREAK) flow = enter<P::Break_stmtContext>(ctx);
+        else if(tpe == P::CONTINUE) flow = enter<P::Continue_stmtContext>(ctx);
+        else flow = enter<P::Return_stmtContext>(ctx);
+        matchAny(flow);
+        if(tpe == P::RETURN && startsTest(la())) testlist(flow);
+        leave(flow), leave(ctx);
+    }
+    void if_stmt(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::If_stmtContext>(parent);
+        matchAny(ctx), test(ctx), match(ctx, P::COLON, "':'"), suite(ctx);
+        while(la() == P::ELIF) matchAny(ctx), test(ctx), match(ctx, P::COLON, "':'"), suite(ctx);
+        if(la() == P::ELSE) matchAny(ctx), match(ctx, P::COLON, "':'"), suite(ctx);
+        leave(ctx);
+    }
+    void while_stmt(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::While_stmtContext>(parent);
+        matchAny(ctx), test(ctx), match(ctx, P::COLON, "':'"), suite(ctx);
+        leave(ctx);
+    }
+    void suite(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::SuiteContext>(parent);
+        if(la() == P::NEWLINE) {
+            matchAny(ctx), match(ctx, P::INDENT, "an indented block");
+            do stmt(ctx); while(la() != P::DEDENT && la() != antlr4::Token::EOF);
+            match(ctx, P::DEDENT, "a dedent");
+        }
+        else simple_stmt(ctx);
+        leave(ctx);
+    }
+
+    void test(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::TestContext>(parent);
+        auto orTest = enter<P::Or_testContext>(ctx);
+        and_test(orTest);
+        while(la() == P::OR) matchAny(orTest), and_test(orTest);
+        leave(orTest), leave(ctx);
+    }
+    void and_test(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::And_testContext>(parent);
+        not_test(ctx);
+        while(la() == P::AND) matchAny(ctx), not_test(ctx);
+        leave(ctx);
+    }
+    void not_test(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::Not_testContext>(parent);
+        if(la() == P::NOT) matchAny(ctx), not_test(ctx);
+        else comparison(ctx);
+        leave(ctx);
+    }
+    void comparison(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::ComparisonContext>(parent);
+        arith_expr(ctx);
+        while(isCompOp(la())) {
+            auto op = enter<P::Comp_opContext>(ctx);
+            matchAny(op);
+            leave(op);
+            arith_expr(ctx);
+        }
+        leave(ctx);
+    }
+    void arith_expr(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::Arith_exprContext>(parent);
+        term(ctx);
+        while(la() == P::ADD || la() == P::MINUS) {
+            auto op = enter<P::Addsub_opContext>(ctx);
+            matchAny(op);
+            leave(op);
+            term(ctx);
+        }
+        leave(ctx);
+    }
+    void term(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::TermContext>(parent);
+        factor(ctx);
+        while(isMulsOp(la())) {
+            auto op = enter<P::Muls_opContext>(ctx);
+            matchAny(op);
+            leave(op);
+            factor(ctx);
+        }
+        leave(ctx);
+    }
+    void factor(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::FactorContext>(parent);
+        if(la() == P::ADD || la() == P::MINUS) {
+            auto op = enter<P::Addsub_opContext>(ctx);
+            matchAny(op);
+            leave(op);
+            factor(ctx);
+        }
+        else {
+            auto expr = enter<P::Atom_exprContext>(ctx);
+            atom(expr);
+            if(la() == P::OPEN_PAREN || la() == P::OPEN_BRACK) trailer(expr);
+            leave(expr);
+        }
+        leave(ctx);
+    }
+    void trailer(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::TrailerContext>(parent);
+        if(la() == P::OPEN_BRACK) return subscript(ctx);
+        matchAny(ctx);
+        if(startsTest(la())) {
+            auto args = enter<P::ArglistContext>(ctx);
+            for(;;) {
+                auto arg = enter<P::ArgumentContext>(args);
+                if(la() == P::NAME && la(2) == P::ASSIGN) matchAny(arg), matchAny(arg);
+                test(arg);
+                leave(arg);
+                if(la() != P::COMMA) break;
+                matchAny(args);
+                if(!startsTest(la())) break;
+            }
+            leave(args);
+        }
+        match(ctx, P::CLOSE_PAREN, "')'");
+        leave(ctx);
+    }
+    void subscript(P::TrailerContext *ctx) {
+        matchAny(ctx);
+        const bool index = startsTest(la());
+        if(index) test(ctx);
+        if(la() == P::COLON) {
+            matchAny(ctx);
+            if(startsTest(la())) test(ctx);
+        } else if(!index) fail("an index");
+        match(ctx, P::CLOSE_BRACK, "']'");
+        leave(ctx);
+    }
+    void atom(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::AtomContext>(parent);
+        switch(la()) {
+            case P::NAME: case P::NUMBER: case P::NONE: case P::TRUE: case P::FALSE:
+                matchAny(ctx);
+                break;
+            case P::STRING:
+                while(la() == P::STRING) matchAny(ctx);
+                break;
+            case P::OPEN_PAREN:
+                matchAny(ctx), test(ctx), match(ctx, P::CLOSE_PAREN, "')'");
+                break;
+            default:
+                fail("an expression");
+        }
+        leave(ctx);
+    }
+    void testlist(antlr4::ParserRuleContext *parent) {
+        auto ctx = enter<P::TestlistContext>(parent);
+        test(ctx);
+        while(la() == P::COMMA) {
+            matchAny(ctx);
+            if(!startsTest(la())) break;
+            test(ctx);
+        }
+        leave(ctx);
+    }
+
+public:
+    string error;
+
+    // tokens must be filled; tree nodes are allocated from tracker.
+    ScriptParser(antlr4::BufferedTokenStream &stream, ParseArena &_tracker): tracker(_tracker), p(0) {
+        for(auto t: stream.getTokens())
+            if(t->getChannel() == antlr4::Token::DEFAULT_CHANNEL) tokens.push_back(t);
+    }
+
+    // the program's tree, or nullptr with error set.
+    P::File_inputContext* file_input() {
+        p = 0, error.clear();
+        auto ctx = tracker.createInstance<P::File_inputContext>(nullptr, -1);
+        ctx->start = tokens[0];
+        try {
+            for(size_t tpe; (tpe = la()) != antlr4::Token::EOF; ) {
+                if(tpe == P::NEWLINE) matchAny(ctx);
+                else stmt(ctx);
+            }
+        } catch(Failed&) {
+            return nullptr;
+        }
+        ctx->addChild(tracker.createInstance<antlr4::tree::TerminalNodeImpl>(tokens[p]));
+        ctx->stop = tokens[p];
+        return ctx;
+    }
+};
+
+// Which stage produced each tree (the program's, or each statement's under --stream) and the time spent in each; for --parse-stats.
+struct ParseStats {
+    unsigned cached, handWritten, sll, ll;
+    double cacheTime, handWrittenTime, sllTime, llTime; // seconds, including attempts that failed
+    size_t arenaNodes, arenaTokens, arenaBytes;
+
+    ParseStats(): cached(0), handWritten(0), sll(0), ll(0), cacheTime(0), handWrittenTime(0), sllTime(0), llTime(0),
+                  arenaNodes(0), arenaTokens(0), arenaBytes(0) {}
+
+    // what a parse put in its arena so far.
+    void count(const ParseArena &arena) {
+        arenaNodes += arena.nodeCount, arenaTokens += arena.tokens.size(), arenaBytes += arena.bytes + arena.tokens.bytes();
+    }
+
+    void report(ostream &os) const {
+        os << "parses: " << cached << " from the program cache, " << handWritten << " recursive descent, " << sll << " SLL, "
+           << ll << " full LL" << endl
+           << "parse time: program cache " << cacheTime * 1e3 << " ms, recursive descent " << handWrittenTime * 1e3
+           << " ms, SLL " << sllTime * 1e3 << " ms, full LL " << llTime * 1e3 << " ms" << endl
+           << "parse arenas: " << arenaNodes << " nodes, " << arenaTokens << " tokens, " << (arenaBytes >> 10) << " KiB" << endl;
+    }
+};
+
+inline double secondsSince(chrono::steady_clock::time_point from) {
+    return chrono::duration<double>(chrono::steady_clock::now() - from).count();
+}
+
+// Python3Parser in two stages: SLL prediction with BailErrorStrategy and no error listener, whose tree is the LL
+// one whenever it gets through, and only if it bails out a second pass with full LL and the default strategy, which
+// reports the syntax errors and recovers. The second pass starts from a reset parser, so the error SLL bailed out
+// at is neither printed nor counted, and the first pass's nodes are freed.
+inline antlr4::tree::ParseTree* parseWithAntlr(Python3Parser &parser, ParseStats &stats) {
+    auto simulator = parser.getInterpreter<antlr4::atn::ParserATNSimulator>();
+    auto start = chrono::steady_clock::now();
+    simulator->setPredictionMode(antlr4::atn::PredictionMode::SLL);
+    parser.setErrorHandler(make_shared<antlr4::BailErrorStrategy>());
+    parser.removeErrorListeners();
+    try {
+        antlr4::tree::ParseTree *ret = parser.file_input();
+        stats.sll++, stats.sllTime += secondsSince(start);
+        return ret;
+    } catch(antlr4::ParseCancellationException&) {
+        stats.sllTime += secondsSince(start);
+    }
+    start = chrono::steady_clock::now();
+    parser.reset(); // rewinds the tokens too
+    simulator->setPredictionMode(antlr4::atn::PredictionMode::LL);
+    parser.setErrorHandler(make_shared<antlr4::DefaultErrorStrategy>());
+    parser.addErrorListener(&antlr4::ConsoleErrorListener::INSTANCE);
+    antlr4::tree::ParseTree *ret = parser.file_input();
+    stats.ll++, stats.llTime += secondsSince(start);
+    return ret;
+}
+
+// Python3Parser over a token stream, constructed on first use: ScriptParser parses nearly every program,
+// and the first Python3Parser constructed is what deserializes the grammar's ATN.
+class AntlrParser {
+private:
+    antlr4::TokenStream &tokens;
+    DfaCache *dfaCache;
+    unique_ptr<Python3Parser> parser;
+
+public:
+    explicit AntlrParser(antlr4::TokenStream &_tokens, DfaCache *_dfaCache = nullptr): tokens(_tokens), dfaCache(_dfaCache) {}
+
+    Python3Parser& get() {
+        if(!parser) {
+            parser.reset(new Python3Parser(&tokens));
+            if(dfaCache) dfaCache->attach(*parser);
+        }
+        return *parser;
+    }
+    size_t syntaxErrors() const {
+        return parser ? parser->getNumberOfSyntaxErrors() : 0;
+    }
+};
+
+// The tree of a filled token stream: ScriptParser's, its nodes in tracker, or if it rejects the program
+// parseWithAntlr's, whose nodes the ANTLR parser keeps.
+inline antlr4::tree::ParseTree* parseProgram(antlr4::BufferedTokenStream &tokens, ParseArena &tracker,
+                                             AntlrParser &fallback, ParseStats &stats) {
+    const auto start = chrono::steady_clock::now();
+    antlr4::tree::ParseTree *ret = ScriptParser(tokens, tracker).file_input();
+    stats.handWrittenTime += secondsSince(start);
+    if(ret) {
+        stats.handWritten++;
+        return ret;
+    }
+    return parseWithAntlr(fallback.get(), stats);
+}
+
+// Compares two parses of the same token stream node by node and reports the first difference on os; for --check-parser.
+// names: for the rule names in the report.
+inline bool sameTrees(antlr4::tree::ParseTree *a, antlr4::tree::ParseTree *b, antlr4::Parser *names, ostream &os) {
+    auto x = dynamic_cast<antlr4::ParserRuleContext*>(a), y = dynamic_cast<antlr4::ParserRuleContext*>(b);
+    bool same;
+    if(x && y) same = x->getRuleIndex() == y->getRuleIndex() && x->start == y->start && x->stop == y->stop
+                      && x->children.size() == y->children.size();
+    else if(!x && !y) same = a->getText() == b->getText()
+                             && ((antlr4::tree::TerminalNode*) a)->getSymbol() == ((antlr4::tree::TerminalNode*) b)->getSymbol();
+    else same = 0;
+    if(!same) {
+        const auto at = x ? x->getStart() : ((antlr4::tree::TerminalNode*) a)->getSymbol();
+        os << "trees differ at line " << at->getLine() << ":" << at->getCharPositionInLine() << ":\n  "
+           << a->toStringTree(names) << "\n  " << b->toStringTree(names) << endl;
+        return 0;
+    }
+    for(size_t i = 0; same && x && i < x->children.size(); i++) same = sameTrees(a->children[i], b->children[i], names, os);
+    return same;
+}
+
+#endif //PYTHON_INTERPRETER_SCRIPTPARSER_HPP
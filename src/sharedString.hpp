@@ -0,0 +1,159 @@
+#ifndef PYTHON_INTERPRETER_SHAREDSTRING_HPP
+#define PYTHON_INTERPRETER_SHAREDSTRING_HPP
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include "slabAllocator.hpp"
+using namespace std;
+
+// A string value: a view of a reference-counted buffer, so that copies and slices share the bytes instead of
+// copying them. A slice stays a view unless it is short, or a small part of a big buffer it would keep alive; then
+// it gets a buffer of its own. Appending writes into the buffer when nothing else sees it, and otherwise first
+// copies the view out. Text is UTF-8; positions and lengths in code points are what slicing and len take.
+class SharedString {
+public:
+    static constexpr size_t minViewBytes = 32; // shorter slices are copied
+    static constexpr size_t keepAliveRatio = 4; // and so are slices of less than a quarter of their buffer
+
+private:
+    struct Buffer {
+        unsigned refs;
+        signed char ascii; // 1, 0, or -1 when not known yet
+        string text;
+        static void* operator new(size_t n) {
+            return slabAllocator.allocate(n);
+        }
+        static void operator delete(void *p, size_t n) {
+            slabAllocator.deallocate(p, n);
+        }
+    };
+    Buffer *buf; // nullptr for ""
+    size_t off, len;
+
+    void release() {
+        if(buf && !--buf->refs) delete buf;
+    }
+    void own(string &&text) { // a buffer of its own, holding text
+        release(), off = 0, len = text.length();
+        buf = len ? new Buffer{1, -1, move(text)} : nullptr;
+    }
+    bool isAscii() const {
+        if(!buf) return 1;
+        if(buf->ascii < 0) {
+            buf->ascii = 1;
+            for(unsigned char c: buf->text) if(c & 0x80) {
+                buf->ascii = 0;
+                break;
+            }
+        }
+        return buf->ascii;
+    }
+    // the byte offset of code point cp of the view, or len past its end.
+    size_t byteOffset(size_t cp) const {
+        if(isAscii()) return min(cp, len);
+        const char *s = data();
+        size_t at = 0;
+        for(; at < len; at++) if(((unsigned char) s[at] & 0xC0) != 0x80 && !cp--) break;
+        return at;
+    }
+
+public:
+    SharedString(): buf(nullptr), off(0), len(0) {}
+    SharedString(const string &s): buf(nullptr) {
+        own(string(s));
+    }
+    SharedString(string &&s): buf(nullptr) {
+        own(move(s));
+    }
+    SharedString(const char *s): buf(nullptr) {
+        own(string(s));
+    }
+    SharedString(const SharedString &x): buf(x.buf), off(x.off), len(x.len) {
+        if(buf) ++buf->refs;
+    }
+    SharedString(SharedString &&x): buf(x.buf), off(x.off), len(x.len) {
+        x.buf = nullptr, x.off = x.len = 0;
+    }
+    ~SharedString() {
+        release();
+    }
+    SharedString& operator = (const SharedString &x) {
+        if(x.buf) ++x.buf->refs;
+        release(), buf = x.buf, off = x.off, len = x.len;
+        return *this;
+    }
+    SharedString& operator = (SharedString &&x) {
+        if(this != &x) release(), buf = x.buf, off = x.off, len = x.len, x.buf = nullptr, x.off = x.len = 0;
+        return *this;
+    }
+
+    const char* data() const {
+        return buf ? buf->text.data() + off : "";
+    }
+    size_t length() const {
+        return len;
+    }
+    size_t size() const {
+        return len;
+    }
+    bool empty() const {
+        return !len;
+    }
+    string str() const {
+        return string(data(), len);
+    }
+
+    size_t codePoints() const {
+        if(isAscii()) return len;
+        const char *s = data();
+        size_t ret = 0;
+        for(size_t i = 0; i < len; i++) ret += ((unsigned char) s[i] & 0xC0) != 0x80;
+        return ret;
+    }
+    // code points from..to (to exclusive, both clamped to the end).
+    SharedString slice(size_t from, size_t to) const {
+        const size_t a = byteOffset(from), b = max(a, byteOffset(to));
+        SharedString ret;
+        if(b - a < minViewBytes || (b - a) * keepAliveRatio < buf->text.length()) {
+            ret.own(string(data() + a, b - a));
+            if(ret.buf && buf->ascii == 1) ret.buf->ascii = 1;
+            return ret;
+        }
+        ret = *this, ret.off += a, ret.len = b - a;
+        return ret;
+    }
+
+    SharedString& operator += (const SharedString &x) {
+        if(!x.len) return *this;
+        if(buf && buf->refs == 1) { // nothing else sees the buffer: drop what lies past the view and append
+            if(x.buf == buf) return *this = *this + x; // x is a view of it that the resize below may cut
+            buf->text.resize(off + len), buf->text.append(x.data(), x.len), len += x.len;
+            if(buf->ascii == 1 && (!x.buf || x.buf->ascii != 1)) buf->ascii = -1;
+            return *this;
+        }
+        string text;
+        text.reserve(len + x.len);
+        text.append(data(), len).append(x.data(), x.len);
+        own(move(text));
+        return *this;
+    }
+    friend SharedString operator + (const SharedString &a, const SharedString &b) {
+        string text;
+        text.reserve(a.len + b.len);
+        text.append(a.data(), a.len).append(b.data(), b.len);
+        return SharedString(move(text));
+    }
+    friend bool operator == (const SharedString &a, const SharedString &b) {
+        return a.len == b.len && !memcmp(a.data(), b.data(), a.len);
+    }
+    friend bool operator != (const SharedString &a, const SharedString &b) {
+        return !(a == b);
+    }
+    friend bool operator < (const SharedString &a, const SharedString &b) { // bytewise, which is code point order in UTF-8
+        const int c = memcmp(a.data(), b.data(), min(a.len, b.len));
+        return c ? c < 0 : a.len < b.len;
+    }
+};
+
+#endif //PYTHON_INTERPRETER_SHAREDSTRING_HPP
@@ -0,0 +1,103 @@
+#ifndef PYTHON_INTERPRETER_SLABALLOCATOR_HPP
+#define PYTHON_INTERPRETER_SLABALLOCATOR_HPP
+
+#include <cstring>
+#include <new>
+#include <ostream>
+#include <vector>
+using namespace std;
+
+// Allocator for the interpreter's small objects that come and go with calls (variable cells, frame map nodes).
+// Requests are rounded up to a multiple of 16 bytes; each size class carves its blocks out of 64 KiB slabs and
+// keeps the blocks freed to it on a freelist, which it hands out first. Slabs are only given back all at once,
+// when the allocator is destroyed at exit. Larger requests go to operator new. Not thread-safe.
+class SlabAllocator {
+public:
+    static constexpr size_t granularity = 16, classes = 16, slabBytes = 64 << 10;
+
+private:
+    struct Block {
+        Block *next;
+    };
+    struct SizeClass {
+        Block *free;
+        char *next, *end; // the unused part of the newest slab
+        size_t allocations, frees, slabs;
+    };
+    SizeClass sizes[classes];
+    size_t largeAllocations, largeFrees;
+    vector<char*> slabs;
+
+public:
+    SlabAllocator(): largeAllocations(0), largeFrees(0) {
+        memset(sizes, 0, sizeof sizes);
+    }
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator = (const SlabAllocator&) = delete;
+    ~SlabAllocator() {
+        for(auto s: slabs) ::operator delete(s);
+    }
+
+    void* allocate(size_t n) {
+        if(!n || n > granularity * classes) return largeAllocations++, ::operator new(n);
+        const size_t k = (n - 1) / granularity, block = (k + 1) * granularity;
+        SizeClass &c = sizes[k];
+        c.allocations++;
+        if(c.free) {
+            Block *ret = c.free;
+            c.free = ret->next;
+            return ret;
+        }
+        if(c.next == c.end) {
+            char *slab = (char*) ::operator new(slabBytes);
+            slabs.push_back(slab), c.slabs++;
+            c.next = slab, c.end = slab + slabBytes / block * block;
+        }
+        void *ret = c.next;
+        c.next += block;
+        return ret;
+    }
+    void deallocate(void *p, size_t n) {
+        if(!n || n > granularity * classes) return largeFrees++, ::operator delete(p);
+        SizeClass &c = sizes[(n - 1) / granularity];
+        Block *b = (Block*) p;
+        b->next = c.free, c.free = b, c.frees++;
+    }
+
+    // for --alloc-stats: the counters of every size class used so far.
+    void report(ostream &os) const {
+        for(size_t k = 0; k < classes; k++) {
+            const SizeClass &c = sizes[k];
+            if(!c.allocations) continue;
+            os << "slab " << (k + 1) * granularity << " bytes: " << c.allocations << " allocations, " << c.frees << " frees, "
+               << c.allocations - c.frees << " live, " << c.slabs << " slabs" << endl;
+        }
+        if(largeAllocations) os << "large: " << largeAllocations << " allocations, " << largeFrees << " frees" << endl;
+    }
+};
+
+// Defined ahead of every global holding slab memory, so it is destroyed after them.
+SlabAllocator slabAllocator;
+
+// An STL allocator on slabAllocator, for node-based containers.
+template<class T>
+class SlabStlAllocator {
+public:
+    typedef T value_type;
+    SlabStlAllocator() {}
+    template<class U> SlabStlAllocator(const SlabStlAllocator<U>&) {}
+    T* allocate(size_t n) {
+        return (T*) slabAllocator.allocate(n * sizeof(T));
+    }
+    void deallocate(T *p, size_t n) {
+        slabAllocator.deallocate(p, n * sizeof(T));
+    }
+    template<class U> bool operator == (const SlabStlAllocator<U>&) const {
+        return 1;
+    }
+    template<class U> bool operator != (const SlabStlAllocator<U>&) const {
+        return 0;
+    }
+};
+
+#endif //PYTHON_INTERPRETER_SLABALLOCATOR_HPP
@@ -0,0 +1,192 @@
+#ifndef PYTHON_INTERPRETER_SOURCESTREAM_HPP
+#define PYTHON_INTERPRETER_SOURCESTREAM_HPP
+
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "antlr4-runtime.h"
+using namespace std;
+
+// The program's bytes: a regular file (named, or redirected to stdin) is mapped read-only, a pipe is read into memory.
+class SourceBuffer {
+private:
+    const char *bytes;
+    size_t length;
+    void *mapped;
+    string owned;
+
+    bool load(int fd) {
+        struct stat st;
+        if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+            if(!st.st_size) return 1;
+            void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(p != MAP_FAILED) {
+                madvise(p, st.st_size, MADV_SEQUENTIAL);
+                mapped = p, bytes = (const char*) p, length = st.st_size;
+                return 1;
+            }
+        }
+        char chunk[1 << 16];
+        for(ssize_t k; (k = ::read(fd, chunk, sizeof chunk)) != 0; ) {
+            if(k < 0) {
+                if(errno == EINTR) continue;
+                return 0;
+            }
+            owned.append(chunk, k);
+        }
+        bytes = owned.data(), length = owned.size();
+        return 1;
+    }
+
+public:
+    SourceBuffer(): bytes(""), length(0), mapped(nullptr) {}
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator = (const SourceBuffer&) = delete;
+    ~SourceBuffer() {
+        if(mapped) munmap(mapped, length);
+    }
+
+    bool open(const char *path) {
+        const int fd = ::open(path, O_RDONLY);
+        if(fd < 0) return 0;
+        const bool ok = load(fd);
+        close(fd);
+        return ok;
+    }
+    bool readStdin() {
+        return load(0);
+    }
+
+    const char* data() const {
+        return bytes;
+    }
+    size_t size() const {
+        return length;
+    }
+};
+
+// CharStream over UTF-8 bytes, indexed by code point as ANTLRInputStream is, without widening to UTF-32.
+// All-ASCII input (the usual case) indexes bytes directly; otherwise every 256th code point's byte offset is
+// kept so seek and getText find their place with a short forward walk.
+class Utf8CharStream: public antlr4::CharStream {
+private:
+    static constexpr size_t checkpointStep = 256;
+    const unsigned char *s;
+    size_t n, count, p, pos; // p: code point index, pos: its byte offset
+    bool ascii;
+    vector<size_t> checkpoints;
+    string name;
+
+    // malformed bytes decode as themselves, one per code point.
+    size_t sequenceLength(size_t at) const {
+        const unsigned char c = s[at];
+        const size_t len = c < 0xC0 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : c < 0xF8 ? 4 : 1;
+        return len < n - at ? len : n - at;
+    }
+    size_t decode(size_t at) const {
+        const unsigned char c = s[at];
+        const size_t len = sequenceLength(at);
+        if(len == 1) return c;
+        size_t cp = c & (0x7F >> len);
+        for(size_t i = 1; i < len; i++) cp = cp << 6 | (s[at + i] & 0x3F);
+        return cp;
+    }
+    size_t byteOffset(size_t index) const {
+        if(ascii) return index;
+        size_t cp, at;
+        if(index >= p && index - p < checkpointStep) cp = p, at = pos;
+        else cp = index / checkpointStep * checkpointStep, at = checkpoints[index / checkpointStep];
+        for(; cp < index; cp++) at += sequenceLength(at);
+        return at;
+    }
+
+public:
+    Utf8CharStream(const char *data, size_t length, const string &sourceName = ""):
+        s((const unsigned char*) data), n(length), p(0), pos(0), ascii(1), name(sourceName) {
+        if(n >= 3 && s[0] == 0xEF && s[1] == 0xBB && s[2] == 0xBF) s += 3, n -= 3; // UTF-8 BOM
+        for(size_t i = 0; i < n; i++) if(s[i] & 0x80) {
+            ascii = 0;
+            break;
+        }
+        if(ascii) {
+            count = n;
+            return;
+        }
+        count = 0;
+        for(size_t at = 0; at < n; at += sequenceLength(at), count++)
+            if(count % checkpointStep == 0) checkpoints.push_back(at);
+        checkpoints.push_back(n);
+    }
+
+    // raw access for ScriptLexer: offsets are into the bytes after any BOM.
+    const unsigned char* bytes() const {
+        return s;
+    }
+    size_t byteLength() const {
+        return n;
+    }
+    size_t codePointAt(size_t at) const {
+        return ascii ? s[at] : decode(at);
+    }
+    size_t codePointLength(size_t at) const {
+        return ascii ? 1 : sequenceLength(at);
+    }
+
+    void consume() override {
+        if(p >= count) throw antlr4::IllegalStateException("cannot consume EOF");
+        pos += ascii ? 1 : sequenceLength(pos), p++;
+    }
+    size_t LA(ssize_t i) override {
+        if(i == 0) return 0; // undefined
+        if(ascii) {
+            const ssize_t at = (ssize_t) p + (i > 0 ? i - 1 : i);
+            return at < 0 || at >= (ssize_t) n ? antlr4::IntStream::EOF : s[at];
+        }
+        if(i > 0) {
+            size_t at = pos;
+            for(ssize_t k = 1; k < i && at < n; k++) at += sequenceLength(at);
+            return at >= n ? antlr4::IntStream::EOF : decode(at);
+        }
+        if((ssize_t) p + i < 0) return antlr4::IntStream::EOF;
+        return decode(byteOffset(p + i));
+    }
+    ssize_t mark() override {
+        return -1;
+    }
+    void release(ssize_t) override {}
+    size_t index() override {
+        return p;
+    }
+    void seek(size_t index) override {
+        if(index > count) index = count;
+        pos = byteOffset(index), p = index;
+    }
+    size_t size() override {
+        return count;
+    }
+    string getSourceName() const override {
+        return name.empty() ? antlr4::IntStream::UNKNOWN_SOURCE_NAME : name;
+    }
+    string getText(const antlr4::misc::Interval &interval) override {
+        if(interval.a < 0 || interval.b < 0) return "";
+        size_t length;
+        const char *ret = text(interval.a, interval.b, length);
+        return string(ret, length);
+    }
+    // code points start..stop in place, as getText would copy them.
+    const char* text(size_t start, size_t stop, size_t &length) const {
+        if(stop >= count) stop = count - 1;
+        if(start >= count || start > stop) return length = 0, "";
+        const size_t from = byteOffset(start);
+        return length = byteOffset(stop + 1) - from, (const char*) s + from;
+    }
+    string toString() const override {
+        return string((const char*) s, n);
+    }
+};
+
+#endif //PYTHON_INTERPRETER_SOURCESTREAM_HPP
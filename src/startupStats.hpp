@@ -0,0 +1,53 @@
+#ifndef PYTHON_INTERPRETER_STARTUPSTATS_HPP
+#define PYTHON_INTERPRETER_STARTUPSTATS_HPP
+
+#include <chrono>
+#include <ctime>
+#include <ostream>
+#include <vector>
+using namespace std;
+
+// --startup-stats: where the time before the first statement runs goes. Phases are timed on the wall clock
+// from the earliest static constructor of the executable; what comes before it (exec, the dynamic loader,
+// the shared libraries' constructors) is only known as the CPU time the process had used by then.
+class StartupStats {
+private:
+    struct Mark {
+        const char *phase;
+        chrono::steady_clock::time_point at;
+    };
+    double loaderTime; // seconds of CPU
+    chrono::steady_clock::time_point origin;
+    vector<Mark> marks;
+
+    StartupStats() {
+        timespec cpu;
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+        loaderTime = cpu.tv_sec + cpu.tv_nsec * 1e-9, origin = chrono::steady_clock::now();
+    }
+
+public:
+    static StartupStats& instance() {
+        static StartupStats ret;
+        return ret;
+    }
+
+    // phase: what ran since the previous mark.
+    void mark(const char *phase) {
+        marks.push_back(Mark{phase, chrono::steady_clock::now()});
+    }
+
+    void report(ostream &os) const {
+        os << "startup: exec and dynamic loading " << loaderTime * 1e3 << " ms of CPU" << endl;
+        auto last = origin;
+        for(auto &m: marks) os << "startup: " << m.phase << " " << chrono::duration<double>(m.at - last).count() * 1e3 << " ms" << endl, last = m.at;
+        os << "startup: " << chrono::duration<double>(last - origin).count() * 1e3 << " ms from static initialization to the first statement" << endl;
+    }
+};
+
+// runs before every static constructor without a priority, which ld orders after those with one.
+__attribute__((constructor(101))) static void startStartupClock() {
+    StartupStats::instance();
+}
+
+#endif //PYTHON_INTERPRETER_STARTUPSTATS_HPP
@@ -0,0 +1,127 @@
+#ifndef PYTHON_INTERPRETER_STATEMENTSTREAM_HPP
+#define PYTHON_INTERPRETER_STATEMENTSTREAM_HPP
+
+#include "antlr4-runtime.h"
+#include "Python3Parser.h"
+#include "Evalvisitor.h"
+#include "dfaCache.hpp"
+#include "optimizer.hpp"
+#include "programPrinter.hpp"
+#include "scriptParser.hpp"
+#include "startupStats.hpp"
+#include "typeInference.hpp"
+#include <memory>
+
+// Splits the lexer's output into top-level statements. A statement ends with a NEWLINE or the DEDENT closing
+// its block at depth 0, unless the next token opens a block (INDENT) or continues an if (elif/else).
+class StatementSplitter {
+private:
+    antlr4::TokenSource &lexer;
+    unique_ptr<antlr4::Token> next;
+
+public:
+    explicit StatementSplitter(antlr4::TokenSource &_lexer): lexer(_lexer), next(_lexer.nextToken()) {}
+
+    // the tokens of the next statement (ListTokenSource appends EOF); 0 at the end of the input.
+    bool read(vector<unique_ptr<antlr4::Token> > &ret) {
+        ret.clear();
+        int depth = 0;
+        while(next->getType() != antlr4::Token::EOF) {
+            const size_t tpe = next->getType();
+            if(tpe == Python3Parser::INDENT) ++depth;
+            else if(tpe == Python3Parser::DEDENT) --depth;
+            ret.push_back(move(next));
+            next = lexer.nextToken();
+            if(depth || (tpe != Python3Parser::NEWLINE && tpe != Python3Parser::DEDENT)) continue;
+            const size_t follow = next->getType();
+            if(follow != Python3Parser::INDENT && follow != Python3Parser::ELIF && follow != Python3Parser::ELSE) break;
+        }
+        return !ret.empty();
+    }
+};
+
+// One statement with what owns its tree.
+struct ParsedStatement {
+    antlr4::ListTokenSource source;
+    antlr4::CommonTokenStream tokens;
+    ParseArena tracker;
+    AntlrParser fallback;
+    antlr4::tree::ParseTree *tree;
+
+    ParsedStatement(vector<unique_ptr<antlr4::Token> > ls, ParseStats &stats, DfaCache *dfaCache):
+        source(move(ls)), tokens(&source), fallback(tokens, dfaCache) {
+        tokens.fill();
+        tree = parseProgram(tokens, tracker, fallback, stats);
+        stats.count(tracker);
+    }
+};
+
+// --stream: statements are parsed, optimized and run one at a time, and freed once run unless they define a
+// function, whose body EvalVisitor keeps pointers into. The passes see one statement, so they assume any
+// earlier global may hold anything and any call may assign any name: a function defined earlier may call one
+// that a later statement defines, and which may be named like a builtin: in a statement that defines functions,
+// calls to builtins are not folded, typed or hoisted either.
+class StatementRunner {
+private:
+    vector<unique_ptr<ParsedStatement> > retained;
+    DfaCache *dfaCache;
+
+    // runs the passes over stmt; with dump, prints it instead and returns 0.
+    bool optimize(ParsedStatement &stmt, ostream *dump, ostream *report) {
+        auto &tracker = stmt.tracker;
+        ConstantFolder(tracker).run(stmt.tree);
+        LoopOptimizer loops(tracker);
+        loops.runStatement(stmt.tree);
+        counted += loops.counted, hoisted += loops.hoisted;
+        if(dump) {
+            ProgramPrinter(*dump).program(stmt.tree);
+            return 0;
+        }
+        TypeInferer inferer;
+        inferer.runStatement(stmt.tree, tracker);
+        AppendRewriter appends(tracker);
+        appends.run(stmt.tree);
+        rewritten += appends.rewritten;
+        if(report) inferer.report(*report);
+        return 1;
+    }
+
+public:
+    int counted, hoisted, rewritten;
+    ParseStats parseStats;
+    explicit StatementRunner(DfaCache *_dfaCache = nullptr): dfaCache(_dfaCache) {
+        counted = hoisted = rewritten = 0;
+    }
+
+    // dump: print each optimized statement instead of running it; report: where --type-report goes;
+    // startup: where --startup-stats goes, just before the first statement runs.
+    void run(antlr4::TokenSource &lexer, ostream *dump, ostream *report, ostream *startup = nullptr) {
+        StatementSplitter splitter(lexer);
+        vector<unique_ptr<antlr4::Token> > ls;
+        EvalVisitor visitor;
+        while(splitter.read(ls)) {
+            unique_ptr<ParsedStatement> stmt(new ParsedStatement(move(ls), parseStats, dfaCache));
+            shadowBuiltins(stmt->tree);
+            vector<Python3Parser::FuncdefContext*> defs;
+            collectFunctions(stmt->tree, defs);
+            if(stmt->fallback.syntaxErrors()) { // as in main(), a tree ANTLR recovered runs as parsed
+                jit.enabled = 0;
+                if(dump) continue;
+            } else {
+                symbols.allShadowed = !defs.empty();
+                const bool optimized = optimize(*stmt, dump, report);
+                symbols.allShadowed = 0;
+                if(!optimized) continue;
+            }
+            if(startup) {
+                StartupStats::instance().mark("parse and optimize the first statement");
+                StartupStats::instance().report(*startup), startup = nullptr;
+            }
+            visitor.visit(stmt->tree);
+            if(!defs.empty()) retained.push_back(move(stmt));
+            else jit.forget(stmt->tree);
+        }
+    }
+};
+
+#endif //PYTHON_INTERPRETER_STATEMENTSTREAM_HPP
@@ -0,0 +1,63 @@
+#ifndef PYTHON_INTERPRETER_SYMBOLTABLE_HPP
+#define PYTHON_INTERPRETER_SYMBOLTABLE_HPP
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Every name of the program, interned once as a small integer id, so that frames and the function tables
+// compare ints where they compared strings. Ids are dense and given in order of first sight; the builtins are
+// interned first, at the ids of Builtin. Ids live as long as the process. Not thread-safe.
+class SymbolTable {
+public:
+    enum Builtin {Print, Int, Float, Str, Bool, Len, builtins};
+
+private:
+    unordered_map<string, int> ids;
+    vector<const string*> names; // keys of ids, which stay put as it grows
+    string key; // lookup buffer, so that finding a known name allocates nothing
+    bool shadowed[builtins]; // the program defines a function of the builtin's name
+
+public:
+    bool allShadowed; // every builtin counts as shadowed; for --stream, while it optimizes function bodies
+
+    SymbolTable(): shadowed(), allShadowed(0) {
+        for(auto t: {"print", "int", "float", "str", "bool", "len"}) intern(t);
+    }
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator = (const SymbolTable&) = delete;
+
+    int intern(const char *s, size_t length) {
+        key.assign(s, length);
+        const auto it = ids.find(key);
+        if(it != ids.end()) return it->second;
+        const auto ret = ids.emplace(key, (int) names.size()).first;
+        names.push_back(&ret->first);
+        return ret->second;
+    }
+    int intern(const string &s) {
+        return intern(s.data(), s.size());
+    }
+    const string& name(int id) const {
+        return *names[id];
+    }
+    size_t size() const {
+        return names.size();
+    }
+    static bool isBuiltin(int id) {
+        return id < builtins;
+    }
+    // a function the program defines takes a builtin's place once its def has run, so the passes must not take
+    // a call to that name for the builtin.
+    void shadow(int id) {
+        if(isBuiltin(id)) shadowed[id] = 1;
+    }
+    bool isShadowed(int id) const {
+        return isBuiltin(id) && (shadowed[id] || allShadowed);
+    }
+};
+
+SymbolTable symbols;
+
+#endif //PYTHON_INTERPRETER_SYMBOLTABLE_HPP
@@ -0,0 +1,95 @@
+#ifndef PYTHON_INTERPRETER_SYNTHETICNODES_HPP
+#define PYTHON_INTERPRETER_SYNTHETICNODES_HPP
+
+#include "antlr4-runtime.h"
+#include "Python3Parser.h"
+#include "dataTypes.hpp"
+#include "parseArena.hpp"
+
+enum SyntheticKind {Specialized, Constant, Hoisted};
+
+class PlannedLoop;
+
+// An atom produced by an optimizer pass instead of the parser.
+// Parsed atoms always have at least one child, so an empty child list is how visitors tell them apart.
+class SyntheticAtom: public Python3Parser::AtomContext {
+public:
+    SyntheticKind kind;
+    antlr4::ParserRuleContext* origin; // the expression this atom stands for
+    DataType value; // Constant: the folded value; Hoisted: the value cached for one activation of loop
+    PlannedLoop* loop;
+    unsigned seen;
+    SyntheticAtom(SyntheticKind _kind, antlr4::ParserRuleContext* _origin):
+            Python3Parser::AtomContext(nullptr, -1), kind(_kind), origin(_origin), loop(nullptr), seen(0) {}
+    virtual std::string getText() override {
+        return origin ? origin->getText() : "";
+    }
+};
+
+// A while loop the loop optimizer made a plan for. Every entry to and exit from the loop bumps
+// generation, which invalidates the values its Hoisted atoms cached in another activation.
+class PlannedLoop: public Python3Parser::While_stmtContext {
+public:
+    unsigned generation;
+    // induction variable: `while counter op bound:` whose body steps counter by a constant in one statement
+    string counter;
+    Python3Parser::ComparisonContext* cond;
+    Python3Parser::StmtContext* step;
+    long long stride;
+    PlannedLoop(): Python3Parser::While_stmtContext(nullptr, -1), generation(0), cond(nullptr), step(nullptr), stride(0) {}
+};
+
+// `name = name + operand`, which EvalVisitor runs as `name += operand` so that a string grows in place.
+// It keeps the statement's children, for the visitors that read it as the assignment it was.
+class AppendStmt: public Python3Parser::Expr_stmtContext {
+public:
+    int target; // symbol id of name
+    Python3Parser::TermContext* operand;
+    AppendStmt(int _target, Python3Parser::TermContext* _operand):
+            Python3Parser::Expr_stmtContext(nullptr, -1), target(_target), operand(_operand) {}
+};
+
+inline bool isSynthetic(Python3Parser::AtomContext* ctx) {
+    return ctx->children.empty();
+}
+
+inline antlr4::ParserRuleContext* makeExprContext(size_t rule, ParseArena &tracker) {
+    switch(rule) {
+        case Python3Parser::RuleTest: return tracker.createInstance<Python3Parser::TestContext>(nullptr, -1);
+        case Python3Parser::RuleOr_test: return tracker.createInstance<Python3Parser::Or_testContext>(nullptr, -1);
+        case Python3Parser::RuleAnd_test: return tracker.createInstance<Python3Parser::And_testContext>(nullptr, -1);
+        case Python3Parser::RuleNot_test: return tracker.createInstance<Python3Parser::Not_testContext>(nullptr, -1);
+        case Python3Parser::RuleComparison: return tracker.createInstance<Python3Parser::ComparisonContext>(nullptr, -1);
+        case Python3Parser::RuleArith_expr: return tracker.createInstance<Python3Parser::Arith_exprContext>(nullptr, -1);
+        case Python3Parser::RuleTerm: return tracker.createInstance<Python3Parser::TermContext>(nullptr, -1);
+        case Python3Parser::RuleFactor: return tracker.createInstance<Python3Parser::FactorContext>(nullptr, -1);
+        default: return tracker.createInstance<Python3Parser::Atom_exprContext>(nullptr, -1);
+    }
+}
+
+inline void replaceChild(antlr4::tree::ParseTree* node, antlr4::tree::ParseTree* with) {
+    auto parent = node->parent;
+    for(auto &child: parent->children) if(child == node) child = with;
+    with->parent = parent;
+}
+
+// Replace the expression node by a single-child chain of the same rule ending in atom,
+// so that every visitor reaching the old position now evaluates the atom instead.
+inline void replaceWithAtom(antlr4::ParserRuleContext* node, SyntheticAtom* atom, ParseArena &tracker) {
+    static const size_t chain[] = {Python3Parser::RuleAtom_expr, Python3Parser::RuleFactor, Python3Parser::RuleTerm,
+                                   Python3Parser::RuleArith_expr, Python3Parser::RuleComparison, Python3Parser::RuleNot_test,
+                                   Python3Parser::RuleAnd_test, Python3Parser::RuleOr_test, Python3Parser::RuleTest};
+    antlr4::ParserRuleContext* cur = atom;
+    const size_t target = node->getRuleIndex();
+    for(auto rule: chain) {
+        if(cur->getRuleIndex() == target) break;
+        auto up = makeExprContext(rule, tracker);
+        up->addChild(cur), cur->parent = up;
+        cur = up;
+    }
+    auto owner = dynamic_cast<SyntheticAtom*>(node->parent);
+    if(owner && owner->origin == node) owner->origin = cur, cur->parent = owner; // node is what a Hoisted atom evaluates
+    else replaceChild(node, cur);
+}
+
+#endif //PYTHON_INTERPRETER_SYNTHETICNODES_HPP
@@ -0,0 +1,416 @@
+#ifndef PYTHON_INTERPRETER_TRANSPILER_HPP
+#define PYTHON_INTERPRETER_TRANSPILER_HPP
+
+#include "Evalvisitor.h"
+#include "treeUtils.hpp"
+#include <sstream>
+
+// Translates a (folded) program to C++ that links against dataTypes.hpp only (--emit-cpp).
+// Every value stays a DataType and every operator is the one EvalVisitor applies, in the same order, so the
+// output matches the interpreter. Names keep the interpreter's frame model: module names are static
+// Variables, a call starts from a copy of them (sharing the cells of assigned globals) and binds fresh
+// Variables for arguments and defaults. Functions must be defined once at top level to be bound statically.
+class CppTranspiler {
+private:
+    ostream &os;
+    EvalVisitor evaluator; // for literals the folder left in place
+    vector<string> constants;
+    map<string, int> constantIndex;
+    set<string> globals;
+    map<string, Python3Parser::FuncdefContext*> functions;
+    Python3Parser::FuncdefContext *current;
+    int loopDepth;
+
+    void fail(const string &why, antlr4::ParserRuleContext *at) {
+        if(error.empty()) error = "line " + to_string(at->getStart()->getLine()) + ": " + why;
+    }
+
+    static string mangle(const string &nme) { // '_' doubles so that escapes stay unique
+        string ret;
+        for(unsigned char c: nme) {
+            if(isalnum(c)) ret += c;
+            else if(c == '_') ret += "__";
+            else {
+                static const char hex[] = "0123456789abcdef";
+                ret += "_x", ret += hex[c >> 4], ret += hex[c & 15];
+            }
+        }
+        return ret;
+    }
+    static string var(const string &nme) {return "v_" + mangle(nme);}
+    static string func(const string &nme) {return "f_" + mangle(nme);}
+    static string defaultOf(const string &function_Name, const string &nme) {return "d_" + mangle(function_Name) + "_" + mangle(nme);}
+
+    static string quote(const string &s) { // octal escapes keep every byte exact
+        string ret = "\"";
+        for(unsigned char c: s) {
+            if(c >= 0x20 && c < 0x7F && c != '"' && c != '\\' && c != '?') ret += c;
+            else ret += '\\', ret += (char) ('0' + (c >> 6)), ret += (char) ('0' + (c >> 3 & 7)), ret += (char) ('0' + (c & 7));
+        }
+        return ret + "\"";
+    }
+
+    string constant(const DataType &x) {
+        string init;
+        if(x.tpe == Bool) init = x.data_Bool ? "DataType((bool) 1)" : "DataType((bool) 0)";
+        else if(x.tpe == Int) {
+            const string digits = x.data_Int.toString();
+            init = digits[0] == '-' ? "-DataType(BigInt(string(\"" + digits.substr(1) + "\")))" : "DataType(BigInt(string(\"" + digits + "\")))";
+        } else if(x.tpe == Float) {
+            unsigned long long bits;
+            char buf[64];
+            memcpy(&bits, &x.data_Float, 8);
+            snprintf(buf, sizeof buf, "DataType(fromBits(0x%016llxull))", bits);
+            init = buf;
+        } else if(x.tpe == String) init = "DataType(string(" + quote(x.data_String.str()) + ", " + to_string(x.data_String.length()) + "))";
+        else init = "DataType(None)";
+        auto it = constantIndex.find(init);
+        if(it == constantIndex.end()) it = constantIndex.insert(make_pair(init, (int) constants.size())).first, constants.push_back(init);
+        return "c" + to_string(it->second);
+    }
+
+    static string indent(int depth) {
+        return string(4 * depth, ' ');
+    }
+
+    // names read or assigned under node, not looking into function bodies.
+    static void collectNames(antlr4::tree::ParseTree *node, set<string> &names) {
+        if(auto def = dynamic_cast<Python3Parser::FuncdefContext*>(node)) return collectNames(def->parameters(), names);
+        if(auto atom = dynamic_cast<Python3Parser::AtomContext*>(node))
+            if(atom->NAME()) names.insert(atom->NAME()->getText());
+        for(auto child: node->children) collectNames(child, names);
+    }
+
+    static bool isNameTarget(Python3Parser::TestContext *test) {
+        antlr4::tree::ParseTree *node = test;
+        while(node->children.size() == 1 && !dynamic_cast<Python3Parser::AtomContext*>(node)) node = node->children[0];
+        const auto atom = dynamic_cast<Python3Parser::AtomContext*>(node);
+        return atom && !isSynthetic(atom) && atom->NAME();
+    }
+
+    // the call a single-child chain passes through unchanged (so a tuple it returns stays a tuple), if any.
+    static Python3Parser::Atom_exprContext* passedCall(antlr4::tree::ParseTree *node) {
+        while(1) {
+            if(auto call = dynamic_cast<Python3Parser::Atom_exprContext*>(node))
+                return call->trailer() && !isSubscript(call->trailer()) && !isBuiltinFunction(call->atom()->getText()) ? call : nullptr;
+            if(auto atom = dynamic_cast<Python3Parser::AtomContext*>(node)) {
+                if(isSynthetic(atom) || !atom->test()) return nullptr;
+                node = atom->test();
+            } else if(node->children.size() == 1) node = node->children[0];
+            else return nullptr;
+        }
+    }
+
+    string lambda(const string &type, const string &body) {
+        return "[&]() -> " + type + " {" + body + "}()";
+    }
+
+    static int tokenOf(antlr4::tree::ParseTree *op) {
+        return static_cast<antlr4::ParserRuleContext*>(op)->getStart()->getType();
+    }
+
+    string atom(Python3Parser::AtomContext *ctx) {
+        if(isSynthetic(ctx)) return constant(static_cast<SyntheticAtom*>(ctx)->value);
+        if(ctx->NAME()) return var(ctx->NAME()->getText()) + ".getContent()";
+        if(ctx->test()) return expr(ctx->test());
+        return constant(evaluator.visit(ctx).as<DataType>());
+    }
+
+    // positional arguments, then keyword ones; parameters nobody passes see the global of that name.
+    string userCall(Python3Parser::Atom_exprContext *ctx) {
+        const string function_Name = ctx->atom()->getText();
+        if(!functions.count(function_Name)) return fail("call to " + function_Name + ", which is not a top-level function", ctx), "";
+        const auto def = functions[function_Name];
+        if(!def->parameters()->typedargslist()) return func(function_Name) + "()"; // arguments are not even evaluated
+        const auto params = def->parameters()->typedargslist()->tfpdef();
+        const unsigned withDefault = def->parameters()->typedargslist()->test().size();
+        vector<int> passed(params.size(), -1);
+        string body;
+        if(ctx->trailer()->arglist()) {
+            const auto args = ctx->trailer()->arglist()->argument();
+            bool keyword = 0;
+            for(unsigned i = 0; i < args.size(); i++) {
+                int slot = -1;
+                if(args[i]->NAME()) {
+                    keyword = 1;
+                    for(unsigned j = 0; j < params.size(); j++) if(params[j]->getText() == args[i]->NAME()->getText()) slot = j;
+                } else if(!keyword && i < params.size()) slot = i;
+                if(slot < 0 || passed[slot] >= 0) return fail("arguments of this call do not match " + function_Name, ctx), "";
+                passed[slot] = i;
+                body += " Variable a" + to_string(i) + " = fresh(" + expr(args[i]->test()) + ");";
+            }
+        }
+        string call = func(function_Name) + "(";
+        for(unsigned j = 0; j < params.size(); j++) {
+            const string nme = params[j]->getText();
+            if(j) call += ", ";
+            if(passed[j] >= 0) call += "a" + to_string(passed[j]);
+            else if(j + withDefault >= params.size()) call += "fresh(" + defaultOf(function_Name, nme) + ")";
+            else call += globals.count(nme) ? "::" + var(nme) : "Variable()";
+        }
+        return lambda("vector<DataType>", body + " return " + call + ");");
+    }
+
+    string call(Python3Parser::Atom_exprContext *ctx) {
+        const string function_Name = ctx->atom()->getText();
+        if(function_Name == "print" && isBuiltinFunction(function_Name)) {
+            string body;
+            if(ctx->trailer()->arglist()) {
+                const auto args = ctx->trailer()->arglist()->argument();
+                for(unsigned i = 0; i < args.size(); i++) {
+                    body += " (" + expr(args[i]->test()) + ").printTo(out);";
+                    if(i + 1 != args.size()) body += " out.put(' ');";
+                }
+            }
+            return lambda("DataType", " OutputWriter &out = OutputWriter::instance();" + body + " out.endLine(); return DataType(None);");
+        }
+        if(isBuiltinFunction(function_Name)) {
+            if(!ctx->trailer()->arglist()) return fail(function_Name + "() needs an argument", ctx), "";
+            const string only = "(" + expr(ctx->trailer()->arglist()->argument(0)->test()) + ")";
+            if(function_Name == "int") return only + ".toInt()";
+            if(function_Name == "float") return only + ".toFloat()";
+            if(function_Name == "str") return only + ".toString()";
+            if(function_Name == "len") return only + ".len()";
+            return only + ".toBool()";
+        }
+        return userCall(ctx) + "[0]";
+    }
+
+    // the value, then the bounds, as EvalVisitor evaluates them.
+    string subscript(Python3Parser::Atom_exprContext *ctx) {
+        string body = " const DataType x = " + atom(ctx->atom()) + ";", bounds[2] = {"DataType(None)", "DataType(None)"};
+        bool isSlice = 0;
+        const auto &ch = ctx->trailer()->children;
+        for(unsigned i = 1; i + 1 < ch.size(); i++) {
+            if(!dynamic_cast<Python3Parser::TestContext*>(ch[i])) isSlice = 1;
+            else bounds[isSlice] = isSlice ? "hi" : "lo", body += " const DataType " + bounds[isSlice] + " = " + expr(ch[i]) + ";";
+        }
+        return lambda("DataType", body + (isSlice ? " return x.slice(" + bounds[0] + ", " + bounds[1] + ");" : " return x.index(" + bounds[0] + ");"));
+    }
+
+    string expr(antlr4::tree::ParseTree *node) {
+        const auto ctx = static_cast<antlr4::ParserRuleContext*>(node);
+        const auto &ch = ctx->children;
+        switch(ctx->getRuleIndex()) {
+            case Python3Parser::RuleOr_test: case Python3Parser::RuleAnd_test: {
+                if(ch.size() == 1) return expr(ch[0]);
+                const bool isOr = ctx->getRuleIndex() == Python3Parser::RuleOr_test;
+                string body;
+                for(unsigned i = 0; i < ch.size(); i += 2)
+                    body += string(" if(") + (isOr ? "" : "!") + "(" + expr(ch[i]) + ").toBool().data_Bool) return DataType((bool) " + (isOr ? "1" : "0") + ");";
+                return lambda("DataType", body + " return DataType((bool) " + (isOr ? "0" : "1") + ");");
+            }
+            case Python3Parser::RuleNot_test:
+                if(ch.size() == 1) return expr(ch[0]);
+                return "DataType((bool) !(" + expr(ch[1]) + ").toBool().data_Bool)";
+            case Python3Parser::RuleComparison: {
+                if(ch.size() == 1) return expr(ch[0]);
+                string body = " DataType hl, hr = " + expr(ch[0]) + ";";
+                for(unsigned i = 1; i < ch.size(); i += 2) {
+                    static const map<int, string> opText = {
+                        {Python3Parser::LESS_THAN, "<"}, {Python3Parser::GREATER_THAN, ">"}, {Python3Parser::EQUALS, "=="},
+                        {Python3Parser::GT_EQ, ">="}, {Python3Parser::LT_EQ, "<="}, {Python3Parser::NOT_EQ_1, "!="}, {Python3Parser::NOT_EQ_2, "!="}};
+                    body += " hl = hr, hr = " + expr(ch[i + 1]) + "; if(!(hl " + opText.at(tokenOf(ch[i])) + " hr)) return DataType((bool) 0);";
+                }
+                return lambda("DataType", body + " return DataType((bool) 1);");
+            }
+            case Python3Parser::RuleArith_expr: case Python3Parser::RuleTerm: {
+                if(ch.size() == 1) return expr(ch[0]);
+                string body = " DataType ret = " + expr(ch[0]) + ";";
+                for(unsigned i = 1; i < ch.size(); i += 2) {
+                    const string hr = expr(ch[i + 1]);
+                    switch(tokenOf(ch[i])) {
+                        case Python3Parser::ADD: body += " ret += " + hr + ";"; break;
+                        case Python3Parser::MINUS: body += " ret -= " + hr + ";"; break;
+                        case Python3Parser::STAR: body += " ret = ret * " + hr + ";"; break;
+                        case Python3Parser::DIV: body += " ret = ret / " + hr + ";"; break;
+                        case Python3Parser::IDIV: body += " ret = dualDiv(ret, " + hr + ");"; break;
+                        default: body += " ret = ret % " + hr + ";";
+                    }
+                }
+                return lambda("DataType", body + " return ret;");
+            }
+            case Python3Parser::RuleFactor:
+                if(ch.size() == 1) return expr(ch[0]);
+                if(tokenOf(ch[0]) == Python3Parser::ADD) return expr(ch[1]);
+                return "-(" + expr(ch[1]) + ")";
+            case Python3Parser::RuleAtom_expr: {
+                const auto call_Ctx = static_cast<Python3Parser::Atom_exprContext*>(ctx);
+                if(!call_Ctx->trailer()) return atom(call_Ctx->atom());
+                return isSubscript(call_Ctx->trailer()) ? subscript(call_Ctx) : call(call_Ctx);
+            }
+            case Python3Parser::RuleAtom: return atom(static_cast<Python3Parser::AtomContext*>(ctx));
+            default: return expr(ch[0]); // test
+        }
+    }
+
+    // a testlist as the vector<DataType> an assignment or return sees.
+    string values(Python3Parser::TestlistContext *ctx) {
+        const auto tests = ctx->test();
+        if(tests.size() == 1) {
+            if(const auto call = passedCall(tests[0])) return userCall(call);
+            return "vector<DataType>{" + expr(tests[0]) + "}";
+        }
+        string ret = "vector<DataType>{"; // braces evaluate left to right
+        for(unsigned i = 0; i < tests.size(); i++) ret += (i ? ", " : "") + expr(tests[i]);
+        return ret + "}";
+    }
+
+    void exprStmt(Python3Parser::Expr_stmtContext *ctx, ostream &out, int depth) {
+        const auto lists = ctx->testlist();
+        if(ctx->augassign()) {
+            if(!isNameTarget(lists[0]->test(0)) || lists[0]->test().size() != 1) return fail("only names can be assigned to", ctx);
+            const string target = var(lists[0]->test(0)->getText()) + ".getContent()";
+            out << indent(depth) << "{ const DataType hr = " << expr(lists[1]->test(0)) << "; ";
+            switch(ctx->augassign()->getStart()->getType()) {
+                case Python3Parser::ADD_ASSIGN: out << target << " += hr;"; break;
+                case Python3Parser::SUB_ASSIGN: out << target << " -= hr;"; break;
+                case Python3Parser::MULT_ASSIGN: out << target << " *= hr;"; break;
+                case Python3Parser::DIV_ASSIGN: out << target << " /= hr;"; break;
+                case Python3Parser::IDIV_ASSIGN: out << "dualDivEqual(" << target << ", hr);"; break;
+                default: out << target << " %= hr;";
+            }
+            out << " }" << endl;
+            return;
+        }
+        if(lists.size() == 1) {
+            for(auto t: lists[0]->test()) out << indent(depth) << "(void) " << expr(t) << ";" << endl;
+            return;
+        }
+        out << indent(depth) << "{ const vector<DataType> nums = " << values(lists.back()) << ";";
+        for(int i = (int) lists.size() - 2; i >= 0; i--) { // rightmost targets first, as EvalVisitor does
+            const auto tests = lists[i]->test();
+            for(unsigned j = 0; j < tests.size(); j++) {
+                if(!isNameTarget(tests[j])) return fail("only names can be assigned to", ctx);
+                out << " " << var(tests[j]->getText()) << " = nums[" << j << "];";
+            }
+        }
+        out << " }" << endl;
+    }
+
+    void suite(Python3Parser::SuiteContext *ctx, ostream &out, int depth) {
+        out << " {" << endl;
+        if(ctx->simple_stmt()) simpleStmt(ctx->simple_stmt(), out, depth + 1);
+        else for(auto t: ctx->stmt()) stmt(t, out, depth + 1);
+        out << indent(depth) << "}";
+    }
+
+    void simpleStmt(Python3Parser::Simple_stmtContext *ctx, ostream &out, int depth) {
+        const auto small = ctx->small_stmt();
+        if(small->expr_stmt()) return exprStmt(small->expr_stmt(), out, depth);
+        const auto flow = small->flow_stmt();
+        if(flow->return_stmt()) {
+            if(!current) return fail("return outside a function", ctx);
+            const auto ret = flow->return_stmt();
+            out << indent(depth) << "return " << (ret->testlist() ? values(ret->testlist()) : "vector<DataType>{DataType(None)}") << ";" << endl;
+            return;
+        }
+        if(!loopDepth) return fail("break or continue outside a loop", ctx);
+        out << indent(depth) << (flow->break_stmt() ? "break;" : "continue;") << endl;
+    }
+
+    void stmt(Python3Parser::StmtContext *ctx, ostream &out, int depth) {
+        if(ctx->simple_stmt()) return simpleStmt(ctx->simple_stmt(), out, depth);
+        const auto compound = ctx->compound_stmt();
+        if(const auto def = compound->funcdef()) {
+            if(current || depth != 1) return fail("functions must be defined at top level", def);
+            if(!def->parameters()->typedargslist()) return;
+            const auto dl = def->parameters()->typedargslist();
+            const auto tests = dl->test();
+            for(unsigned i = 0; i < tests.size(); i++) // last default first, as EvalVisitor does
+                out << indent(depth) << defaultOf(def->NAME()->getText(), dl->tfpdef(dl->tfpdef().size() - i - 1)->getText()) << " = "
+                    << expr(tests[tests.size() - i - 1]) << ";" << endl;
+            return;
+        }
+        if(const auto loop = compound->while_stmt()) {
+            out << indent(depth) << "while((" << expr(loop->test()) << ").toBool().data_Bool)";
+            ++loopDepth, suite(loop->suite(), out, depth), --loopDepth;
+            out << endl;
+            return;
+        }
+        const auto branch = compound->if_stmt();
+        const auto tests = branch->test();
+        const auto suites = branch->suite();
+        out << indent(depth);
+        for(unsigned i = 0; i < suites.size(); i++) {
+            if(i) out << " else ";
+            if(i < tests.size()) out << "if((" << expr(tests[i]) << ").toBool().data_Bool)";
+            suite(suites[i], out, depth);
+        }
+        out << endl;
+    }
+
+    void function(Python3Parser::FuncdefContext *def, ostream &out) {
+        current = def;
+        const string function_Name = def->NAME()->getText();
+        set<string> params, locals;
+        out << "static vector<DataType> " << func(function_Name) << "(";
+        if(def->parameters()->typedargslist()) {
+            const auto ls = def->parameters()->typedargslist()->tfpdef();
+            for(unsigned i = 0; i < ls.size(); i++) out << (i ? ", " : "") << "Variable " << var(ls[i]->getText()), params.insert(ls[i]->getText());
+        }
+        out << ")";
+        collectNames(def->suite(), locals);
+        stringstream body;
+        suite(def->suite(), body, 0);
+        string text = body.str();
+        string frame;
+        for(auto &t: locals)
+            if(!params.count(t)) frame += indent(1) + "Variable " + var(t) + (globals.count(t) ? " = ::" + var(t) : "") + ";\n";
+        text.insert(text.find('\n') + 1, frame);
+        text.insert(text.rfind('}'), indent(1) + "return vector<DataType>{DataType(None)};\n");
+        out << text << endl << endl;
+        current = nullptr;
+    }
+
+public:
+    string error;
+
+    explicit CppTranspiler(ostream &_os): os(_os), current(nullptr), loopDepth(0) {}
+
+    // returns 0 (with error set) when the program is outside what can be bound statically.
+    bool run(antlr4::tree::ParseTree *tree) {
+        vector<Python3Parser::StmtContext*> top;
+        for(auto t: tree->children) if(auto s = dynamic_cast<Python3Parser::StmtContext*>(t)) top.push_back(s);
+        for(auto s: top) {
+            if(!s->compound_stmt() || !s->compound_stmt()->funcdef()) continue;
+            const auto def = s->compound_stmt()->funcdef();
+            if(functions.count(def->NAME()->getText())) fail(def->NAME()->getText() + " is defined twice", def);
+            functions[def->NAME()->getText()] = def;
+        }
+        collectNames(tree, globals);
+
+        stringstream functionText, mainText;
+        for(auto &t: functions) function(t.second, functionText);
+        for(auto s: top) stmt(s, mainText, 1);
+        if(!error.empty()) return 0;
+
+        os << "// Generated by `code --emit-cpp`; build with the interpreter's flags, e.g." << endl;
+        os << "//     g++ -std=c++14 -Ofast -I<interpreter>/src program.cpp" << endl;
+        os << "#include \"dataTypes.hpp\"" << endl << "#include \"outputWriter.hpp\"" << endl << endl;
+        os << "static double fromBits(unsigned long long x) {" << endl << "    double ret;" << endl
+           << "    memcpy(&ret, &x, sizeof ret);" << endl << "    return ret;" << endl << "}" << endl << endl;
+        os << "static Variable fresh(const DataType &x) {" << endl << "    Variable ret;" << endl
+           << "    ret = x;" << endl << "    return ret;" << endl << "}" << endl << endl;
+        for(unsigned i = 0; i < constants.size(); i++) os << "static const DataType c" << i << " = " << constants[i] << ";" << endl;
+        for(auto &t: globals) os << "static Variable " << var(t) << ";" << endl;
+        for(auto &t: functions)
+            if(t.second->parameters()->typedargslist()) {
+                const auto dl = t.second->parameters()->typedargslist();
+                for(unsigned i = dl->tfpdef().size() - dl->test().size(); i < dl->tfpdef().size(); i++)
+                    os << "static DataType " << defaultOf(t.first, dl->tfpdef(i)->getText()) << ";" << endl;
+            }
+        os << endl;
+        for(auto &t: functions) {
+            os << "static vector<DataType> " << func(t.first) << "(";
+            if(t.second->parameters()->typedargslist())
+                for(unsigned i = 0; i < t.second->parameters()->typedargslist()->tfpdef().size(); i++) os << (i ? ", " : "") << "Variable";
+            os << ");" << endl;
+        }
+        os << endl << functionText.str();
+        os << "int main() {" << endl << "    OutputWriter::instance().install();" << endl << mainText.str() << "    return 0;" << endl << "}" << endl;
+        return 1;
+    }
+};
+
+#endif //PYTHON_INTERPRETER_TRANSPILER_HPP
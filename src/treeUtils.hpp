@@ -0,0 +1,102 @@
+#ifndef PYTHON_INTERPRETER_TREEUTILS_HPP
+#define PYTHON_INTERPRETER_TREEUTILS_HPP
+
+#include "Python3Parser.h"
+#include "compactTokens.hpp"
+#include <set>
+#include <vector>
+#include <string>
+using namespace std;
+
+// Queries over the parse tree shared by the optimizer passes.
+
+// what node->getText() gives, without the stringstream RuleContext::getText builds at every level of the
+// single-child chains most names and numbers sit at the bottom of.
+inline string textOf(antlr4::tree::ParseTree *node) {
+    while(node->children.size() == 1) node = node->children[0];
+    if(auto leaf = dynamic_cast<antlr4::tree::TerminalNode*>(node)) return leaf->getSymbol()->getText();
+    return node->getText();
+}
+
+// the symbol id of what textOf(node) gives; a name's comes from its token without building any text.
+inline int nameOf(antlr4::tree::ParseTree *node) {
+    while(node->children.size() == 1) node = node->children[0];
+    if(auto leaf = dynamic_cast<antlr4::tree::TerminalNode*>(node)) return symbolOf(leaf->getSymbol());
+    return symbols.intern(node->getText());
+}
+
+// whether a call to nme is surely a builtin's: the program defines no function of that name.
+inline bool isBuiltinFunction(const string &nme) {
+    for(int i = 0; i < SymbolTable::builtins; i++) if(nme == symbols.name(i)) return !symbols.isShadowed(i);
+    return 0;
+}
+
+// `x[...]` rather than a call.
+inline bool isSubscript(Python3Parser::TrailerContext *trailer) {
+    return trailer->getStart()->getType() == Python3Parser::OPEN_BRACK;
+}
+
+inline void collectTargets(Python3Parser::Expr_stmtContext *ctx, set<string> &names) {
+    if(ctx->augassign()) {
+        names.insert(ctx->testlist(0)->test(0)->getText());
+        return;
+    }
+    const auto testLists = ctx->testlist();
+    for(unsigned i = 0; i + 1 < testLists.size(); i++)
+        for(auto t: testLists[i]->test()) names.insert(t->getText());
+}
+
+// names assigned by statements under node, not counting the bodies of nested functions.
+inline void collectAssigned(antlr4::tree::ParseTree *node, set<string> &names) {
+    if(dynamic_cast<Python3Parser::FuncdefContext*>(node)) return;
+    if(auto stmt = dynamic_cast<Python3Parser::Expr_stmtContext*>(node)) return collectTargets(stmt, names);
+    for(auto child: node->children) collectAssigned(child, names);
+}
+
+inline void collectFunctions(antlr4::tree::ParseTree *node, vector<Python3Parser::FuncdefContext*> &ret) {
+    if(auto def = dynamic_cast<Python3Parser::FuncdefContext*>(node)) ret.push_back(def);
+    for(auto child: node->children) collectFunctions(child, ret);
+}
+
+// marks the builtins that functions defined under tree shadow; to be run on a tree before the passes and
+// EvalVisitor see it.
+inline void shadowBuiltins(antlr4::tree::ParseTree *tree) {
+    vector<Python3Parser::FuncdefContext*> defs;
+    collectFunctions(tree, defs);
+    for(auto def: defs) symbols.shadow(symbolOf(def->NAME()->getSymbol()));
+}
+
+// names assigned in the bodies of functions defined under tree, other than their parameters.
+inline set<string> functionLocals(antlr4::tree::ParseTree *tree) {
+    set<string> ret;
+    vector<Python3Parser::FuncdefContext*> defs;
+    collectFunctions(tree, defs);
+    for(auto def: defs) {
+        set<string> assigned;
+        collectAssigned(def->suite(), assigned);
+        if(def->parameters()->typedargslist())
+            for(auto arg: def->parameters()->typedargslist()->tfpdef()) assigned.erase(arg->getText());
+        ret.insert(assigned.begin(), assigned.end());
+    }
+    return ret;
+}
+
+// A function frame starts as a copy of the globals, so a function assigning a name that is also a
+// global writes the caller-visible Variable. These are the names a call may change behind our back.
+inline set<string> clobberedByCalls(antlr4::tree::ParseTree *tree) {
+    set<string> globals, ret;
+    collectAssigned(tree, globals);
+    for(auto t: functionLocals(tree)) if(globals.count(t)) ret.insert(t);
+    return ret;
+}
+
+// whether evaluating node may call a user function (nested function bodies are not evaluated).
+inline bool containsUserCall(antlr4::tree::ParseTree *node) {
+    if(dynamic_cast<Python3Parser::FuncdefContext*>(node)) return 0;
+    if(auto call = dynamic_cast<Python3Parser::Atom_exprContext*>(node))
+        if(call->trailer() && !isSubscript(call->trailer()) && !isBuiltinFunction(call->atom()->getText())) return 1;
+    for(auto child: node->children) if(containsUserCall(child)) return 1;
+    return 0;
+}
+
+#endif //PYTHON_INTERPRETER_TREEUTILS_HPP
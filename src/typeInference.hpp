@@ -0,0 +1,407 @@
+#ifndef PYTHON_INTERPRETER_TYPEINFERENCE_HPP
+#define PYTHON_INTERPRETER_TYPEINFERENCE_HPP
+
+#include "Python3BaseVisitor.h"
+#include "syntheticNodes.hpp"
+#include "treeUtils.hpp"
+#include <map>
+#include <set>
+
+// Flow-sensitive type inference run once before execution. Arithmetic and comparisons whose
+// operands are proven to be Int/Float are replaced by Specialized synthetic atoms, which
+// EvalVisitor evaluates without the generic DataType conversions; everything else stays dynamic.
+
+enum StaticType {Unassigned, KnownBool, KnownInt, KnownFloat, KnownString, KnownNone, Dynamic};
+
+inline StaticType joinType(const StaticType &a, const StaticType &b) {
+    if(a == b || b == Unassigned) return a;
+    if(a == Unassigned) return b;
+    return Dynamic;
+}
+
+inline bool isNumericType(const StaticType &t) {
+    return t == KnownBool || t == KnownInt || t == KnownFloat;
+}
+
+inline bool isArithType(const StaticType &t) { // the operand types Specialized atoms accept
+    return t == KnownInt || t == KnownFloat;
+}
+
+class TypeEnv {
+public:
+    map<string, StaticType> vars;
+    StaticType fallback; // type of a name not assigned in this region yet
+    bool reachable;
+    explicit TypeEnv(const StaticType &_fallback = Unassigned) {
+        fallback = _fallback, reachable = 1;
+    }
+    StaticType get(const string &nme) const {
+        const auto it = vars.find(nme);
+        return it == vars.end() ? fallback : it->second;
+    }
+    friend TypeEnv join(const TypeEnv &a, const TypeEnv &b) {
+        if(!a.reachable) return b;
+        if(!b.reachable) return a;
+        TypeEnv ret = a;
+        for(auto t: b.vars) ret.vars[t.first] = joinType(a.get(t.first), t.second);
+        for(auto t: a.vars) if(!b.vars.count(t.first)) ret.vars[t.first] = joinType(t.second, b.fallback);
+        return ret;
+    }
+    friend bool operator == (const TypeEnv &a, const TypeEnv &b) {
+        return a.reachable == b.reachable && a.vars == b.vars;
+    }
+    friend bool operator != (const TypeEnv &a, const TypeEnv &b) {
+        return !(a == b);
+    }
+};
+
+// result types mirror the DataType operators in dataTypes.hpp.
+inline StaticType addSubType(const StaticType &a, const StaticType &b, bool isAdd) {
+    if(isNumericType(a) && isNumericType(b)) return a == KnownFloat || b == KnownFloat ? KnownFloat : KnownInt;
+    if(isAdd && a == KnownString && b == KnownString) return KnownString;
+    return Dynamic;
+}
+
+inline StaticType mulsType(const StaticType &a, const StaticType &b, size_t op) {
+    if(op == Python3Parser::IDIV || op == Python3Parser::MOD) return KnownInt;
+    if(op == Python3Parser::STAR && (a == KnownString || b == KnownString)) return KnownString;
+    if(!isNumericType(a) || !isNumericType(b)) return Dynamic;
+    if(op == Python3Parser::DIV) return KnownFloat;
+    return a == KnownFloat || b == KnownFloat ? KnownFloat : KnownInt;
+}
+
+class TypeInferer: public Python3BaseVisitor {
+private:
+    struct LoopFrame {
+        TypeEnv breaks, continues;
+    };
+    struct Candidate {
+        bool ok;
+        StaticType kind;
+        string region;
+    };
+    TypeEnv env;
+    vector<LoopFrame> loops;
+    vector<Python3Parser::FuncdefContext*> pendingFunctions;
+    set<string> clobbered; // globals some function body may overwrite through a shared Variable
+    bool clobbersAll; // a call may assign any name, as it may reach functions not seen yet
+    map<antlr4::ParserRuleContext*, Candidate> candidates;
+    vector<antlr4::ParserRuleContext*> order;
+    string region;
+    bool inFunction, giveUp;
+
+    void record(antlr4::ParserRuleContext *ctx, bool ok, const StaticType &kind) {
+        auto it = candidates.find(ctx);
+        if(it == candidates.end()) {
+            candidates[ctx] = Candidate{ok, kind, region};
+            order.push_back(ctx);
+        } else {
+            it->second.ok = it->second.ok && ok;
+            if(kind != it->second.kind) it->second.kind = KnownFloat;
+        }
+    }
+
+    StaticType typeOf(antlr4::tree::ParseTree *ctx) {
+        return visit(ctx).as<StaticType>();
+    }
+
+    void assign(const string &nme, const StaticType &t) {
+        env.vars[nme] = t == Unassigned ? Dynamic : t;
+    }
+
+    int analyze(antlr4::tree::ParseTree *tree, ParseArena &tracker) {
+        region = "<module>";
+        visit(tree);
+        for(unsigned i = 0; i < pendingFunctions.size(); i++) {
+            const auto def = pendingFunctions[i];
+            env = TypeEnv(Dynamic), loops.clear();
+            region = def->NAME()->getText(), inFunction = 1;
+            if(def->parameters()->typedargslist())
+                for(auto arg: def->parameters()->typedargslist()->tfpdef()) env.vars[arg->getText()] = Dynamic;
+            visitSuite(def->suite());
+        }
+        if(giveUp) {
+            candidates.clear(), order.clear();
+            return 0;
+        }
+        int cnt = 0;
+        for(auto ctx: order) if(candidates[ctx].ok) {
+            replaceWithAtom(ctx, tracker.createInstance<SyntheticAtom>(Specialized, ctx), tracker);
+            ++cnt;
+        }
+        return cnt;
+    }
+
+public:
+    TypeInferer() {
+        inFunction = 0, giveUp = 0, clobbersAll = 0;
+    }
+
+    // analyze the whole program and install Specialized atoms; returns the number installed.
+    int run(antlr4::tree::ParseTree *tree, ParseArena &tracker) {
+        clobbered = clobberedByCalls(tree);
+        return analyze(tree, tracker);
+    }
+    // for one statement of a program run piecewise: names bound before it have unknown types, and a call may
+    // assign any name, since the functions it reaches may be defined by later statements.
+    int runStatement(antlr4::tree::ParseTree *tree, ParseArena &tracker) {
+        env = TypeEnv(Dynamic), clobbersAll = 1;
+        return analyze(tree, tracker);
+    }
+
+    void report(ostream &os) {
+        int cnt = 0;
+        for(auto ctx: order) {
+            const auto &info = candidates[ctx];
+            if(!info.ok) continue;
+            ++cnt;
+            os << "specialized " << (info.kind == KnownInt ? "int  " : "float") << " " << info.region << ":"
+               << ctx->getStart()->getLine() << ":" << ctx->getStart()->getCharPositionInLine() << "  "
+               << ctx->getText() << endl;
+        }
+        os << cnt << " of " << order.size() << " arithmetic expressions specialized";
+        if(giveUp) os << " (inference disabled: flow statement outside its loop or function)";
+        os << endl;
+    }
+
+    virtual antlrcpp::Any visitFile_input(Python3Parser::File_inputContext *ctx) override {
+        for(auto t: ctx->stmt()) visitStmt(t);
+        return nullptr;
+    }
+
+    virtual antlrcpp::Any visitFuncdef(Python3Parser::FuncdefContext *ctx) override {
+        if(ctx->parameters()->typedargslist())
+            for(auto t: ctx->parameters()->typedargslist()->test()) typeOf(t);
+        pendingFunctions.push_back(ctx);
+        return nullptr;
+    }
+
+    virtual antlrcpp::Any visitExpr_stmt(Python3Parser::Expr_stmtContext *ctx) override {
+        const auto testLists = ctx->testlist();
+        if(ctx->augassign()) {
+            const auto hr = typeOf(testLists[1]->test(0));
+            const auto nme = testLists[0]->test(0)->getText();
+            auto hl = env.get(nme);
+            if(hl == Unassigned) hl = Dynamic;
+            const auto op = ctx->augassign()->getStart()->getType();
+            if(op == Python3Parser::ADD_ASSIGN) assign(nme, addSubType(hl, hr, 1));
+            else if(op == Python3Parser::SUB_ASSIGN) assign(nme, addSubType(hl, hr, 0));
+            else if(op == Python3Parser::MULT_ASSIGN) assign(nme, mulsType(hl, hr, Python3Parser::STAR));
+            else if(op == Python3Parser::DIV_ASSIGN) assign(nme, mulsType(hl, hr, Python3Parser::DIV));
+            else assign(nme, KnownInt); // '//=' and '%='
+            return nullptr;
+        }
+        const auto values = testLists.back()->test();
+        vector<StaticType> types;
+        for(auto t: values) types.push_back(typeOf(t));
+        for(unsigned i = 0; i + 1 < testLists.size(); i++) {
+            const auto tests = testLists[i]->test();
+            for(unsigned j = 0; j < tests.size(); j++) {
+                // a lone value may be a tuple returned by a function.
+                const bool known = j < types.size() && (values.size() > 1 || j == 0);
+                assign(tests[j]->getText(), known ? types[j] : Dynamic);
+            }
+        }
+        return nullptr;
+    }
+
+    virtual antlrcpp::Any visitBreak_stmt(Python3Parser::Break_stmtContext*) override {
+        if(loops.empty()) {
+            giveUp = 1;
+            return nullptr;
+        }
+        loops.back().breaks = join(loops.back().breaks, env);
+        env.reachable = 0;
+        return nullptr;
+    }
+
+    virtual antlrcpp::Any visitContinue_stmt(Python3Parser::Continue_stmtContext*) override {
+        if(loops.empty()) {
+            giveUp = 1;
+            return nullptr;
+        }
+        loops.back().continues = join(loops.back().continues, env);
+        env.reachable = 0;
+        return nullptr;
+    }
+
+    virtual antlrcpp::Any visitReturn_stmt(Python3Parser::Return_stmtContext *ctx) override {
+        if(!inFunction) giveUp = 1;
+        if(ctx->testlist()) visitTestlist(ctx->testlist());
+        env.reachable = 0;
+        return nullptr;
+    }
+
+    virtual antlrcpp::Any visitIf_stmt(Python3Parser::If_stmtContext *ctx) override {
+        const auto ls_test = ctx->test();
+        const auto ls_suite = ctx->suite();
+        TypeEnv out = env;
+        out.reachable = 0;
+        for(unsigned i = 0; i < ls_test.size(); i++) {
+            typeOf(ls_test[i]);
+            const TypeEnv notTaken = env;
+            visitSuite(ls_suite[i]);
+            out = join(out, env);
+            env = notTaken;
+        }
+        if(ls_suite.size() > ls_test.size()) visitSuite(ls_suite.back());
+        env = join(out, env);
+        return nullptr;
+    }
+
+    virtual antlrcpp::Any visitWhile_stmt(Python3Parser::While_stmtContext *ctx) override {
+        TypeEnv head = env, exits;
+        for(int round = 0; ; round++) {
+            env = head;
+            typeOf(ctx->test());
+            exits = env;
+            LoopFrame frame{TypeEnv(head.fallback), TypeEnv(head.fallback)};
+            frame.breaks.reachable = frame.continues.reachable = 0;
+            loops.push_back(frame);
+            visitSuite(ctx->suite());
+            frame = loops.back();
+            loops.pop_back();
+            exits = join(exits, frame.breaks);
+            const TypeEnv next = join(head, join(env, frame.continues));
+            if(next == head) break;
+            head = next;
+            if(round == 8) for(auto &t: head.vars) t.second = Dynamic; // give the lattice a hard stop
+        }
+        env = exits;
+        return nullptr;
+    }
+
+    virtual antlrcpp::Any visitSuite(Python3Parser::SuiteContext *ctx) override {
+        if(ctx->simple_stmt()) return visitSimple_stmt(ctx->simple_stmt());
+        for(auto t: ctx->stmt()) {
+            if(!env.reachable) break;
+            visitStmt(t);
+        }
+        return nullptr;
+    }
+
+    virtual antlrcpp::Any visitTest(Python3Parser::TestContext *ctx) override {
+        return visitOr_test(ctx->or_test());
+    }
+
+    virtual antlrcpp::Any visitOr_test(Python3Parser::Or_testContext *ctx) override {
+        const auto ls = ctx->and_test();
+        if(ls.size() == 1) return visitAnd_test(ls[0]);
+        for(auto t: ls) typeOf(t);
+        return KnownBool;
+    }
+
+    virtual antlrcpp::Any visitAnd_test(Python3Parser::And_testContext *ctx) override {
+        const auto ls = ctx->not_test();
+        if(ls.size() == 1) return visitNot_test(ls[0]);
+        for(auto t: ls) typeOf(t);
+        return KnownBool;
+    }
+
+    virtual antlrcpp::Any visitNot_test(Python3Parser::Not_testContext *ctx) override {
+        if(ctx->comparison()) return visitComparison(ctx->comparison());
+        typeOf(ctx->not_test());
+        return KnownBool;
+    }
+
+    virtual antlrcpp::Any visitComparison(Python3Parser::ComparisonContext *ctx) override {
+        const auto ariths = ctx->arith_expr();
+        if(ariths.size() == 1) return visitArith_expr(ariths[0]);
+        bool ok = 1, allInt = 1;
+        for(auto t: ariths) {
+            const auto tpe = typeOf(t);
+            ok = ok && isArithType(tpe), allInt = allInt && tpe == KnownInt;
+        }
+        record(ctx, ok, allInt ? KnownInt : KnownFloat);
+        return KnownBool;
+    }
+
+    virtual antlrcpp::Any visitArith_expr(Python3Parser::Arith_exprContext *ctx) override {
+        const auto list_ops = ctx->addsub_op();
+        const auto list_nums = ctx->term();
+        if(list_ops.empty()) return visitTerm(list_nums[0]);
+        auto ret = typeOf(list_nums[0]);
+        bool ok = isArithType(ret);
+        for(unsigned i = 0; i < list_ops.size(); i++) {
+            const auto hr = typeOf(list_nums[i + 1]);
+            ok = ok && isArithType(hr);
+            ret = addSubType(ret, hr, list_ops[i]->getStart()->getType() == Python3Parser::ADD);
+        }
+        record(ctx, ok, ret);
+        return ret;
+    }
+
+    virtual antlrcpp::Any visitTerm(Python3Parser::TermContext *ctx) override {
+        const auto list_ops = ctx->muls_op();
+        const auto list_nums = ctx->factor();
+        if(list_ops.empty()) return visitFactor(list_nums[0]);
+        auto ret = typeOf(list_nums[0]);
+        bool ok = isArithType(ret);
+        for(unsigned i = 0; i < list_ops.size(); i++) {
+            const auto hr = typeOf(list_nums[i + 1]);
+            const auto op = list_ops[i]->getStart()->getType();
+            ok = ok && isArithType(hr);
+            if(op == Python3Parser::IDIV || op == Python3Parser::MOD) ok = ok && ret == KnownInt && hr == KnownInt;
+            ret = mulsType(ret, hr, op);
+        }
+        record(ctx, ok, ret);
+        return ret;
+    }
+
+    virtual antlrcpp::Any visitFactor(Python3Parser::FactorContext *ctx) override {
+        if(!ctx->addsub_op()) return visitAtom_expr(ctx->atom_expr());
+        const auto tpe = typeOf(ctx->factor());
+        if(ctx->addsub_op()->getStart()->getType() == Python3Parser::ADD) return tpe;
+        if(tpe == KnownFloat || tpe == Dynamic) return tpe;
+        return KnownInt;
+    }
+
+    virtual antlrcpp::Any visitAtom_expr(Python3Parser::Atom_exprContext *ctx) override {
+        if(!ctx->trailer()) return visitAtom(ctx->atom());
+        if(isSubscript(ctx->trailer())) {
+            typeOf(ctx->atom());
+            for(auto t: ctx->trailer()->children)
+                if(auto test = dynamic_cast<Python3Parser::TestContext*>(t)) typeOf(test);
+            return KnownString;
+        }
+        if(ctx->trailer()->arglist())
+            for(auto t: ctx->trailer()->arglist()->argument()) typeOf(t->test());
+        const string function_Name = ctx->atom()->getText();
+        if(isBuiltinFunction(function_Name)) {
+            if(function_Name == "print") return KnownNone;
+            if(function_Name == "int") return KnownInt;
+            if(function_Name == "float") return KnownFloat;
+            if(function_Name == "str") return KnownString;
+            if(function_Name == "bool") return KnownBool;
+            return KnownInt; // len
+        }
+        if(clobbersAll) for(auto &t: env.vars) t.second = Dynamic;
+        else for(auto t: clobbered) if(env.vars.count(t)) env.vars[t] = Dynamic;
+        return Dynamic;
+    }
+
+    virtual antlrcpp::Any visitAtom(Python3Parser::AtomContext *ctx) override {
+        if(isSynthetic(ctx)) {
+            const auto atom = static_cast<SyntheticAtom*>(ctx);
+            static const StaticType known[] = {KnownBool, KnownInt, KnownFloat, KnownString, KnownNone};
+            return atom->kind == Constant ? known[atom->value.tpe] : typeOf(atom->origin);
+        }
+        if(ctx->NAME()) {
+            const auto tpe = env.get(ctx->NAME()->getText());
+            return tpe == Unassigned ? Dynamic : tpe;
+        }
+        if(ctx->NUMBER()) return ctx->getText().find('.') != string::npos ? KnownFloat : KnownInt;
+        if(!ctx->STRING().empty()) return KnownString;
+        if(ctx->test()) return visitTest(ctx->test());
+        return ctx->getText() == "None" ? KnownNone : KnownBool;
+    }
+
+    virtual antlrcpp::Any visitTestlist(Python3Parser::TestlistContext *ctx) override {
+        const auto tests = ctx->test();
+        if(tests.size() == 1) return visitTest(tests[0]);
+        for(auto t: tests) typeOf(t);
+        return Dynamic;
+    }
+};
+
+#endif //PYTHON_INTERPRETER_TYPEINFERENCE_HPP
@@ -0,0 +1,12 @@
+#!/bin/sh
+# usage: cachedProgram.sh code program.py
+# Runs the program twice with a fresh --program-cache directory: the first run optimizes and saves the tree,
+# the second must load it, unless the program has syntax errors and was never saved. Both must print the .out file.
+code=$1 program=$2
+here=$(dirname "$0")
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+sh "$here/runProgram.sh" "$code" "$program" --program-cache "$dir" || exit 1
+[ -z "$(ls "$dir")" ] || "$code" --parse-stats --program-cache "$dir" < "$program" 2>&1 > /dev/null | grep -q "^parses: 1 from the program cache" ||
+    { echo "$program: not loaded from the program cache"; exit 1; }
+sh "$here/runProgram.sh" "$code" "$program" --program-cache "$dir"
@@ -0,0 +1,15 @@
+#!/bin/sh
+# usage: flatMemory.sh code
+# A million calls, nearly all of them recursive, with locals in every frame, must need no more memory than ten
+# thousand: the peak RSS --alloc-stats reports may grow by 1 MiB at most.
+code=$1
+program() {
+    printf 'def depth(n, tag):\n    k = n * 2\n    s = tag + "x"\n    if n:\n        return depth(n - 1, s) + k\n    return k\n'
+    printf 'i = 0\nwhile i < %d:\n    depth(49, "")\n    i += 1\nprint(i)\n' "$1"
+}
+peak() {
+    program "$1" | "$code" --alloc-stats 2>&1 > /dev/null | sed -n 's/^peak RSS: \([0-9]*\) KiB$/\1/p'
+}
+small=$(peak 200) large=$(peak 20000)
+echo "peak RSS: $small KiB after 10000 calls, $large KiB after 1000000"
+[ -n "$small" ] && [ -n "$large" ] && [ $((large - small)) -le 1024 ]
@@ -0,0 +1,112 @@
+# usage: generatePrograms.py seed count dir
+# Writes count random programs of the grammar's subset to dir/0.py, dir/1.py, ...; every third one has a few
+# tokens dropped, added or swapped, so that most of those are syntax errors. For parserDifferential.sh.
+import os
+import random
+import sys
+
+seed, count, out = int(sys.argv[1]), int(sys.argv[2]), sys.argv[3]
+rng = random.Random(seed)
+R = rng.random
+
+
+def atom(d):
+    c = rng.randint(0, 5 if d > 3 else 7)
+    if c == 0: return rng.choice(["a", "b", "x1", "f", "print"])
+    if c == 1: return rng.choice(["1", "2.5", "0", "123456789012345"])
+    if c == 2: return " ".join(rng.choice(["'s'", '"t"', "'''u'''"]) for _ in range(rng.randint(1, 3)))
+    if c in (3, 4, 5): return rng.choice(["None", "True", "False"])
+    if c == 6: return "(" + test(d + 1) + ")"
+    return rng.choice(["f", "g", "print"]) + "(" + arglist(d + 1) + ")"
+
+
+def arglist(d):
+    if R() < 0.2: return ""
+    args = [("k%d=" % i if R() < 0.3 else "") + test(d + 1) for i in range(rng.randint(1, 3))]
+    return ", ".join(args) + ("," if R() < 0.2 else "")
+
+
+def factor(d):
+    return rng.choice(["-", "+", "", "- ", ""]) + atom(d)
+
+
+def term(d):
+    s = factor(d)
+    while R() < 0.3 and d < 5: s += rng.choice([" * ", " / ", " // ", " % "]) + factor(d + 1)
+    return s
+
+
+def arith(d):
+    s = term(d)
+    while R() < 0.3 and d < 5: s += rng.choice([" + ", " - "]) + term(d + 1)
+    return s
+
+
+def comparison(d):
+    s = arith(d)
+    while R() < 0.2 and d < 5: s += rng.choice([" < ", " > ", " == ", " >= ", " <= ", " != "]) + arith(d + 1)
+    return s
+
+
+def test(d=0):
+    s = comparison(d)
+    if R() < 0.1: s = "not " + s
+    while R() < 0.15 and d < 5: s += rng.choice([" and ", " or "]) + comparison(d + 1)
+    return s
+
+
+def testlist():
+    n = rng.randint(1, 3) if R() < 0.2 else 1
+    return ", ".join(test() for _ in range(n)) + ("," if R() < 0.1 else "")
+
+
+def simple(inLoop, inFunction):
+    c = R()
+    if inLoop and c < 0.1: return rng.choice(["break", "continue"])
+    if inFunction and c < 0.2: return "return" + (" " + testlist() if R() < 0.7 else "")
+    if c < 0.4: return testlist()
+    if c < 0.6: return rng.choice(["a", "b", "c"]) + rng.choice([" += ", " -= ", " *= ", " /= ", " //= ", " %= "]) + test()
+    return " = ".join(rng.choice(["a", "b", "c", "a, b"]) for _ in range(rng.randint(1, 3))) + " = " + testlist()
+
+
+def suite(indent, d, inLoop, inFunction, head):
+    if R() < 0.3 or d > 3: return [indent + head + " " + simple(inLoop, inFunction)]
+    lines = [indent + head]
+    for _ in range(rng.randint(1, 4)): lines += stmt(indent + "    ", d + 1, inLoop, inFunction)
+    return lines
+
+
+def stmt(indent, d, inLoop, inFunction):
+    c = R()
+    if d < 4 and c < 0.15:
+        lines = suite(indent, d, inLoop, inFunction, "if " + test() + ":")
+        for _ in range(rng.randint(0, 2)): lines += suite(indent, d, inLoop, inFunction, "elif " + test() + ":")
+        if R() < 0.5: lines += suite(indent, d, inLoop, inFunction, "else:")
+        return lines
+    if d < 4 and c < 0.25: return suite(indent, d, True, inFunction, "while " + test() + ":")
+    if d < 4 and c < 0.32:
+        params = ", ".join("p%d" % i + ("=" + test() if R() < 0.3 else "") for i in range(rng.randint(0, 3)))
+        return suite(indent, d, False, True, "def fn(" + params + "):")
+    if c < 0.36 and indent == "": return [""]
+    return [indent + simple(inLoop, inFunction)]
+
+
+def mutate(text):
+    words = text.split(" ")
+    for _ in range(rng.randint(1, 3)):
+        i = rng.randrange(len(words))
+        c = R()
+        if c < 0.4: del words[i]
+        elif c < 0.7: words.insert(i, rng.choice(["(", ")", ",", "=", ":", "if", "else", "+", "*", "not", "return", "a"]))
+        else: words[i] = rng.choice(["(", ")", ",", "=", ":", "elif", "x", "1", "\n"])
+        if not words: words = ["a"]
+    return " ".join(words)
+
+
+os.makedirs(out, exist_ok=True)
+for k in range(count):
+    lines = []
+    for _ in range(rng.randint(1, 12)): lines += stmt("", 0, False, False)
+    text = "\n".join(lines) + "\n"
+    if k % 3 == 0: text = mutate(text)
+    with open(os.path.join(out, "%d.py" % k), "w") as f: f.write(text)
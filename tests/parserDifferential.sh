@@ -0,0 +1,22 @@
+#!/bin/sh
+# usage: parserDifferential.sh code [seed] [count]
+# Parses generated programs with --check-parser: ScriptParser must build the same tree as Python3Parser, node for
+# node, or reject the same programs. Skipped (exit 77) without python3 to generate them.
+code=$1 seed=${2:-1} count=${3:-300}
+command -v python3 > /dev/null || { echo "python3 not found"; exit 77; }
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+python3 "$(dirname "$0")/generatePrograms.py" "$seed" "$count" "$dir" || exit 1
+match=0 rejected=0 failed=0
+for program in "$dir"/*.py; do
+    "$code" --check-parser "$program" > "$dir/log" 2>&1
+    status=$?
+    if [ $status -eq 0 ] && grep -q "trees match" "$dir/log"; then match=$((match + 1))
+    elif [ $status -eq 0 ]; then rejected=$((rejected + 1))
+    else
+        failed=$((failed + 1))
+        echo "== $program (exit status $status)"; cat "$program"; tail -5 "$dir/log"
+    fi
+done
+echo "seed $seed: $match trees match, $rejected rejected by both, $failed differ or crash"
+[ $failed -eq 0 ]
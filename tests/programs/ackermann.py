@@ -0,0 +1,32 @@
+# deep recursion
+def ack(m, n):
+    if m == 0:
+        return n + 1
+    if n == 0:
+        return ack(m - 1, 1)
+    return ack(m - 1, ack(m, n - 1))
+print(ack(2, 3))
+total = 0
+def add(v):
+    total = total + v
+    return total
+print(add(3), add(4), total)
+a = 3
+while a > 0:
+    b = 0
+    while b < a:
+        b += 1
+        if b == 2:
+            break
+    print(a, b)
+    a -= 1
+s = "-" * 10
+print(s)
+print("abc" < "abd", "b" > "a", 2 <= 2.0, 3 >= 4)
+f1 = 2.5
+f2 = 2
+print(f1 // 1, f1 % 2)
+def divs(x):
+    return x / 7
+print(divs(22), divs(1.0))
+print(1 // 1, 0 % 5)
@@ -0,0 +1,34 @@
+# arithmetic and printing
+a = 2 * 1024
+b = a // 3
+c = a % 7
+d = a / 3
+print(a, b, c, d)
+print(-7 // 2, -7 % 2, 7 // -2, 7 % -2)
+print(1.5 + 2, 3 - 0.25, 2 * 2.5, 10 / 4)
+print("ab" "cd", 'x' * 3, 3 * "yz")
+print(True + True, True * 3, False - 1)
+print(1 < 2 < 3, 3 > 2 > 2, 1 == 1.0, "a" == "a", "a" != "b", None == None)
+print(not 0, not "", 1 and 0, 0 or 2, 5 and 7)
+print(int(3.9), int("123"), float(2), str(15) + "!", bool(0), bool("x"), str(1.5))
+print(12345678901234567890 * 98765432109876543210)
+print(100000000000000000000 // 7, 100000000000000000000 % 7)
+x = y = 5
+x += 3
+y -= 1
+print(x, y)
+x *= 2
+x //= 3
+print(x)
+x /= 2
+print(x)
+x %= 2
+print(x)
+p, q = 1, 2
+p, q = q, p
+print(p, q)
+print(None, True, False)
+print()
+print(0.1 + 0.2, 1e-7 * 1, -0.0000001, 123456.7890125, 2.5 - 3)
+s = ""
+print(s, "end")
@@ -0,0 +1,33 @@
+# branches and statements that can never run
+def f(x):
+    if x > 3:
+        return "big"
+        print("dead")
+    elif 0:
+        return "never"
+    elif True:
+        return "small"
+    else:
+        return "dead too"
+print(f(5), f(1))
+if 0:
+    print("a")
+elif False:
+    print("b")
+if 1:
+    print("one")
+    y = 2 * 3
+else:
+    print("no")
+print(y)
+i = 0
+while i < 5:
+    i += 1
+    if i == 2:
+        continue
+        print("dead")
+    if i == 4:
+        break
+    print(i)
+z = int("12") + float(3) * 2
+print(z, str(7) + "k")
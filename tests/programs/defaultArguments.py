@@ -0,0 +1,41 @@
+# default arguments are evaluated once, where the function is defined
+def noisy(v):
+    print("noisy", v)
+    return v
+def f(a, b = noisy(2), c = noisy(3)):
+    print("f", a, b, c)
+    return a + b, c
+x, y = f(1)
+print(x, y)
+p, q = f(c = 10, a = 5)
+print(p, q)
+g = 100
+def uses(g, h = 1):
+    return g
+print(uses(h = 4))
+cnt = 0
+def bump(k):
+    cnt = cnt + k
+    tmp = cnt * 2
+    return tmp
+print(bump(3), bump(4), cnt)
+a = b = noisy(7)
+print(a, b)
+def pair():
+    return noisy(1), noisy(2)
+u, v = pair()
+print(u, v, "tab\tq\"uote'\\", 'single "dq"')
+def nothing():
+    x = 1
+print(nothing(), nothing(5))
+s = ""
+i = 0
+while i < 5:
+    i += 1
+    if i == 2:
+        continue
+    s = s + str(i) + ","
+    if i >= 4:
+        break
+print(s, i, 1.0 / 3, -0.5 * 3, 7 // -2, -7 % 3, 2.5 > 2, not 0, 1 and 0 or 3)
+print(int("12") + 1, float(3), bool(""), str(True) * 2)
@@ -0,0 +1,36 @@
+# arguments and operands are evaluated left to right
+def say(x):
+    print("in", x)
+    return x
+print("a", say(1), "b", say(2))
+def kw(first, second = 2, third = 3):
+    return first * 100 + second * 10 + third
+print(kw(1, third = 9), kw(second = 5, first = 4))
+i = 0
+acc = 0
+while i < 2000:
+    j = 0
+    while j < 50:
+        acc = acc + i * j % 7
+        j += 1
+    i += 1
+print(acc)
+r = 0.0
+q = 0
+while q < 1000:
+    r = r + q / 3
+    q = q + 1
+print(r)
+def countdown(n):
+    while n > 0:
+        n -= 1
+    return n
+print(countdown(1000))
+v = 5
+while v != 0:
+    v = v - 1
+print(v)
+w = 10
+while w >= 0:
+    w -= 3
+print(w)
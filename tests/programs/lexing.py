@@ -0,0 +1,39 @@
+# tokens of every kind: the lexer tests run ScriptLexer against Python3Lexer on each program here
+a = 'single' + "double"   # a comment after code
+b = '''triple
+quoted''' + """and "again" """
+c = "escapes: \" \' \\ \t|"
+d = ("joined "
+     "across lines" +
+     str(1 +
+       2))
+
+e = 3.25 + .5 + 7. + 0 + 1234567890123456789012345
+if a != b and not c == d or e >= 1 and e <= 2 or e > 0 and e < 9:
+	print("tab indented")
+	if 1:
+	        print("deeper")
+    # a comment at another indentation
+
+print(a, b, c, d, e)
+print("unicode: héllo wörld ✓")
+x = 10
+x += 1
+x -= 2
+x *= 3
+x //= 4
+x %= 5
+print(x, 7 // 2, 7 % 3, -x, +x, x == x)
+def f(p, q = 2):
+    return p
+print(f(1), None, True, False)
+y = 9
+while y:
+    y -= 1
+    if y == 7:
+        continue
+    elif y < 3:
+        break
+    else:
+        y /= 1
+print(y)
@@ -0,0 +1,87 @@
+# counters near the long long limit, early exits, and calls that assign the loop's names
+a = -7
+b = 3
+i = 0
+while i < 12:
+    q = a // b
+    r = a % b
+    print(q, r, a * 2 // -3, (-a) % -4)
+    a = a + 5
+    i += 1
+x = 1
+n = 0
+while n < 80:
+    x = x * 3
+    n += 1
+print(x)
+def fact(k):
+    r = 1
+    while k > 1:
+        r = r * k
+        k -= 1
+    return r
+m = 0
+while m < 25:
+    print(fact(m))
+    m += 1
+def mix(k):
+    return k / 2 + 0.25 * k - k // 3
+j = 0
+while j < 6:
+    print(mix(j), mix(j * 1.5))
+    j += 1
+big = 9007199254740990
+c = 0
+while c < 5:
+    f = big + c
+    print(f / 1, f * 1.0)
+    c += 1
+u = 0
+acc = 0
+while u < 40:
+    u += 1
+    if u % 3 == 0 and not u % 5 == 0:
+        continue
+    if 30 < u <= 35 or u == 2:
+        acc -= u
+    elif u > 37:
+        break
+    else:
+        acc += u * u
+print(u, acc)
+def sgn(v):
+    if v > 0:
+        return 1
+    if v < 0:
+        return -1.0
+def h(v):
+    t = 0
+    while t < 3:
+        t += 1
+    v = v + t
+k = -3
+while k < 4:
+    print(sgn(k), h(k))
+    k += 1
+z = 0.1
+w = 0
+while w < 30:
+    z = z * 1.1 - 0.05 / (w + 1)
+    w += 1
+    if z > 1e3 or z < -1e3:
+        break
+print(z, w)
+p = 5
+while p > -5:
+    p -= 1
+    tmp = p * -1
+    print(tmp, -p, +p, 1 < 2 < p, p != 2, p == 2.0, p >= 1.5, 0.5 <= p)
+print(tmp)
+s = 0
+t = 2
+while s < 3:
+    t = t * t
+    s += 1
+    while t > 1000000000000000000:
+        t = t // 7
+print(t)
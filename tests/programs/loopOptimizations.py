@@ -0,0 +1,73 @@
+# loops whose invariants are hoisted and whose counters run as machine integers
+def sq(x):
+    return x * x
+n = 10
+a = 3
+b = 4
+i = 0
+s = 0
+while i < n:
+    s += a * b + i
+    i += 1
+print(s, i)
+i = 9223372036854775800
+while i < 9223372036854775810:
+    print(i)
+    i += 3
+j = 10
+while j >= 0:
+    j -= 2
+    if j == 4:
+        continue
+    if j == 2:
+        break
+    print("j", j, a * b * 2)
+def f(m):
+    k = 0
+    t = 0
+    while k < m:
+        t += 0
+        if k == 5:
+            return t + k * (m + 1)
+        k += 1
+        t += m * m
+    return t
+print(f(3), f(10))
+def g(m):
+    if m == 0:
+        return 0
+    k = 0
+    acc = 0
+    while k < m:
+        acc += g(m - 1) + m * 7
+        k += 1
+    return acc
+print(g(4))
+x = 1.5
+while x < 5:
+    x += 1
+print(x)
+c = 0
+def bump():
+    c = c + 1
+    return c
+c = 0
+while c < 5:
+    print(bump())
+    c += 1
+u = 0
+while u < 3:
+    v = 0
+    while v < u * 2 + 1:
+        print(u, v, u * 10 + b * b)
+        v += 1
+    u += 1
+w = 0
+while w < 2 * 2:
+    w += 1
+print(w)
+p = 0
+q = "ab"
+while p < 3:
+    print(q + q, str(p * 2))
+    p = p + 1
@@ -0,0 +1,61 @@
+# while loops, continue and elif chains
+i = 0
+s = 0
+n = 300
+while i < n * n:
+    s += i * 2 + 1
+    i += 1
+print(s)
+j = 10
+t = 0.0
+while j > 0:
+    t += j * 0.5
+    j -= 2
+print(t)
+k = 0
+while k < 10:
+    k += 3
+    if k == 6:
+        continue
+    print(k)
+if False:
+    print("no")
+elif 1 == 1:
+    print("yes")
+else:
+    print("never")
+while 0:
+    print("x")
+m = 0
+while m <= 50:
+    m += 7
+print(m)
+x = 1.0
+c = 0
+while x < 1000000.0:
+    x = x * 1.5 + 0.25
+    c += 1
+print(x, c)
+big = 1
+e = 0
+while e < 80:
+    big = big * 3 + 1
+    e += 1
+print(big)
+def sq(a):
+    r = 0
+    w = 0
+    while w < a:
+        r += a
+        w += 1
+    return r
+print(sq(123), sq(0))
+def mix(a, b):
+    return a * b + a // b - a % b
+print(mix(17, 5), mix(-17, 5), mix(17, -5))
+str1 = "a"
+cnt = 0
+while cnt < 5:
+    str1 = str1 + "b"
+    cnt += 1
+print(str1)
@@ -0,0 +1,52 @@
+# recursive calls
+def fib(n):
+    if n < 2:
+        return n
+    return fib(n - 1) + fib(n - 2)
+print(fib(20))
+
+def f(a, b = 10, c = "x"):
+    print(a, b, c)
+    return a + b
+print(f(1))
+print(f(1, 2))
+print(f(1, c = "y"))
+print(f(a = 5, b = 6))
+
+def pair(x):
+    return x, x * 2
+u, v = pair(21)
+print(u, v)
+
+g = 100
+def useg():
+    print(g)
+    g = 5
+useg()
+print(g)
+
+def noret():
+    k = 1
+print(noret())
+
+def loop(n):
+    i = 0
+    s = 0
+    while True:
+        i += 1
+        if i > n:
+            break
+        if i % 2 == 0:
+            continue
+        s += i
+    return s
+print(loop(100))
+
+def early(n):
+    i = 0
+    while i < n:
+        if i == 7:
+            return i * 10
+        i += 1
+    return -1
+print(early(100), early(3))
@@ -0,0 +1,20 @@
+# --stream optimizes f before it sees g: the loop must not hoist k * 1, which the call to g changes
+k = 2
+def f():
+    t = 0
+    i = 0
+    while i < 3:
+        t = t + k * 1
+        g()
+        i += 1
+    return t
+def g():
+    k = k + 2
+print(f())
+print(k)
+# and g2's body is optimized before str becomes the program's own: str(5) must not be folded
+def g2():
+    return str(5)
+def str(v):
+    return "S"
+print(g2())
@@ -0,0 +1,52 @@
+# string subscripts and slices: bounds taken as Python takes them, positions in code points rather than bytes,
+# and views sharing their string's bytes, which appending to either must leave as they were
+s = "abcdefghij"
+print(s[0], s[9], s[-1], s[-10])
+print(s[2:5], s[:3], s[7:], s[:], s[-3:], s[:-7], s[-4:-1])
+print(s[3:100], s[-100:2], s[8:3] == "", s[5:5] == "", len(s[20:]), len(s[-20:-15]))
+# a slice of a slice: the grammar takes one trailer, so through a name
+t = s[1:]
+t = t[1:]
+t = t[1:]
+print(t, t[2:4], len(s), len(""))
+u = "héllo wörld ✓"
+print(len(u), u[1], u[-1], u[6:11], u[-5:], u[1:2] == "é", len(u[11:]))
+digits = "0123456789" * 10
+# 31 bytes are copied, 32 of 100 are a view
+a = digits[0:31]
+b = digits[0:32]
+# 40 of 100 bytes are a view, 40 of 200 are under a quarter and copied
+c = digits[50:90]
+d = ("xy" * 100)[0:40]
+print(len(a), len(b), len(c), len(d))
+a += "!"
+b += "!"
+c += "?"
+d += "?"
+print(a)
+print(b)
+print(c)
+print(d)
+print(digits[0:33], digits[88:], len(digits))
+alias = digits
+alias += "tail"
+print(len(digits), len(alias), alias[-6:], digits[-2:])
+view = digits[5:95]
+view += "end"
+print(digits == "0123456789" * 10, view[:7], view[-5:], len(view))
+again = view[0:90]
+view += "more"
+print(again[-3:], view[-7:], len(again), len(view))
+wide = "ö" * 40
+part = wide[0:20]
+part += "!"
+print(len(wide), len(part), part[-2:], wide[-1])
+# a view left alone with its buffer appends in place, dropping the bytes past it
+p = "abcdefghij" * 10
+q = p[20:60]
+p = ""
+q += "!"
+print(q, len(q))
+r = ("abcdefghij" * 10)[60:100]
+r += r
+print(r, len(r))
@@ -0,0 +1,6 @@
+# a syntax error in a function that is never called: the statements around it still run
+print(1)
+def f():
+    x = 1 +
+    return x
+print(3)
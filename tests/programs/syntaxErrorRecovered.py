@@ -0,0 +1,4 @@
+# the parser recovers from the stray '*' and reports it once, as the generated parser always did
+print(1)
+x = 1 +* 2
+print(x)
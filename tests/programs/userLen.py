@@ -0,0 +1,20 @@
+# a function named like a builtin takes its place once its def has run, and the passes must not fold, type or
+# hoist its calls as the builtin's
+s = "hello"
+print(len(s))
+calls = 0
+def len(x):
+    calls = calls + 1
+    return "len of " + x
+print(len(s))
+total = ""
+i = 0
+while i < 3:
+    total = total + len("ab") + ";"
+    i += 1
+print(total)
+print(calls)
+def twice(n):
+    return len(str(n)) + len("!")
+print(twice(42))
+print(calls)
@@ -0,0 +1,26 @@
+# floor division, modulo and products with zero and negative operands, in loops and functions hot enough for
+# --jit to compile; a zero result must be a plain zero either way
+def fdiv(a, b):
+    return a // b
+def fmod(a, b):
+    return a % b
+def fmul(a, b):
+    return a * b
+i = 0
+s = 0
+while i < 300:
+    a = i % 7 - 3
+    b = i // 7 % 7 - 3
+    if b != 0:
+        s = (s * 31 + fdiv(a, b) * 7 + fmod(a, b) + fmul(a, b) + 5) % 1000003
+    i += 1
+print(s)
+q = 0
+k = 0
+while k < 100:
+    q = 0 // -3 + q * 0
+    k += 1
+print(q, q == 0, q < 0, q >= 0, float(q))
+print(fdiv(0, -3), fdiv(0, -3) == 0, float(fdiv(0, -3)), fmod(0, -3) == 0)
+print(fmul(0, -5), fmul(0, -5) == 0, fmul(-5, 0) < 0, float(fmul(0, -5)))
+print(0 // -3 == 0, 0 * -3 == 0, float(0 * -3), float(0 // -7), -7 // 8, 7 // -8, -7 % 8, 7 % -8)
@@ -0,0 +1,15 @@
+#!/bin/sh
+# usage: runProgram.sh code program.py [flags...]
+# Runs the program with the flags and compares what it prints with the .out file next to it, and what it reports
+# on stderr with the .err file, if there is one.
+code=$1 program=$2
+shift 2
+out=$(mktemp) || exit 1
+err=$(mktemp) || exit 1
+trap 'rm -f "$out" "$err"' EXIT
+"$code" "$@" < "$program" > "$out" 2> "$err"
+status=$?
+[ $status = 0 ] || { cat "$err"; echo "$program $*: exit status $status"; exit 1; }
+[ -f "${program%.py}.err" ] || cat "$err" >&2
+diff -u "${program%.py}.out" "$out" || exit 1
+[ ! -f "${program%.py}.err" ] || diff -u "${program%.py}.err" "$err"